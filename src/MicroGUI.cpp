@@ -25,15 +25,28 @@
 #include <ArduinoJson.hpp>
 
 #include <string.h>
+#include <esp_heap_caps.h>
+#include <nvs.h>
 
 
-static LGFX lcd; // declare display variable
+/* LovyanGFX with a board hint, so that autodetection only checks the board found at the previous boot */
+class MGUI_LGFX : public LGFX {
+  public:
+    void setBoard(lgfx::board_t board) { _board = board; }
+};
+
+static MGUI_LGFX lcd; // declare display variable
+static MGUI_boot boot;
+static uint16_t canvas_color = 0;   // Painted before the GUI is rendered
 
 /* Setup screen resolution for LVGL */
 static uint16_t screenWidth;
 static uint16_t screenHeight;
 static lv_disp_draw_buf_t draw_buf;
 static lv_color_t buf[4800];
+static SemaphoreHandle_t lcd_mutex = NULL;    // The display and touch controller may share a bus
+static lv_disp_t * disp = NULL;
+static lv_indev_drv_t * touch_drv = NULL;
 
 /* Variables/objects for MicroGUI events */
 static MGUI_event * default_event = new MGUI_event("Default", "None", 0);
@@ -48,19 +61,154 @@ LinkedList<MGUI_object*> sliders;
 LinkedList<MGUI_object*> checkboxes;
 LinkedList<MGUI_object*> textfields;
 LinkedList<MGUI_object*> dividers;
+LinkedList<MGUI_object*> numerics;
+LinkedList<MGUI_object*> images;
+LinkedList<MGUI_object*> tables;
+LinkedList<MGUI_object*> charts;
+
+/* Registry of all rendered objects, indexed by MGUI_object index, for constant time lookups */
+static MGUI_object ** registry = NULL;
+static uint16_t registry_size = 0;
+static uint16_t registry_capacity = 0;
+
+/* Change journal for delta sync, a ring buffer of the latest state changes */
+typedef struct {
+  uint32_t version;
+  uint16_t index;
+} MGUI_change;
+
+static MGUI_change journal[MGUI_JOURNAL_SIZE];
+static uint16_t journal_head = 0;       // Next position to write to
+static uint16_t journal_count = 0;
+static uint32_t state_version = 0;      // Incremented on every state change, never reset
+static uint32_t state_epoch = 0;        // Changes on every render, versions from another epoch are meaningless
+static uint32_t journal_floor = 0;      // State version at the time of the latest render
+
+/* The registry slots of the document's objects, so that objects on pages that are not built are found without parsing it */
+typedef enum {
+  MGUI_SLOT_NONE,       // Object without a value
+  MGUI_SLOT_TEXT,       // Textfield
+  MGUI_SLOT_STATE,      // Switch and Checkbox
+  MGUI_SLOT_VALUE       // Slider and Numeric
+} MGUI_slot_kind;
+
+typedef struct {
+  uint32_t name_hash;
+  uint8_t kind;
+  char * name;          // Set while the object is not built and has a value the document may not have yet
+  char * text;
+  int value;
+  uint32_t version;     // State version of the value
+  bool patched;         // Set while a patch changes the object in the document
+} MGUI_slot;
 
-/* For storing the initial json document internally */
-char document[20000];
+static MGUI_slot * slot_table = NULL;
+static uint16_t slot_count = 0;
+
+/* For storing the initial json document internally, allocated to fit it */
+char * document = NULL;
+static size_t document_capacity = 0;
 
 bool from_persistant = false;
 
+/* Content hash of the latest rendered GUI document, lets clients validate their cached copy */
+static uint32_t document_hash = 0;
+
+/* Set when the document has been patched but not yet stored in flash */
+static bool doc_dirty = false;
+static uint32_t doc_dirty_time = 0;
+
+/* Pages of the GUI document, each page is a screen which is only built while needed */
+typedef struct {
+  lv_obj_t * screen;      // NULL while the page is not built
+  uint32_t last_used;
+} MGUI_page;
+
+static MGUI_page * pages = NULL;
+static uint8_t page_count = 0;
+static uint8_t active_page = 0;
+static int16_t pending_page = -1;         // Page switch requested from an event callback, done in mgui_run
+static bool prebuild_pending = false;
+static lv_obj_t * build_screen = NULL;    // Screen that rendered objects are created on
+
+static MGUI_stats stats;
+
+/* Shared styles, objects that look the same use the same style instead of their own local style properties */
+typedef enum {
+  MGUI_STYLE_FLAT,      // Background color without border and rounded corners
+  MGUI_STYLE_BG,        // Background color
+  MGUI_STYLE_BORDER,    // Border color
+  MGUI_STYLE_TEXT,      // Text color
+  MGUI_STYLE_FONT,      // Font, variant is the font size
+  MGUI_STYLE_PAD        // Padding on all sides, variant is the padding
+} MGUI_style_kind;
+
+typedef struct {
+  uint8_t kind;
+  uint8_t variant;
+  uint32_t color;
+  bool used;            // Set while looking for styles that no object uses anymore
+  lv_style_t style;
+} MGUI_style;
+
+LinkedList<MGUI_style*> styles;
+
+/* Static layer, objects that never change are drawn once into a screen sized image which is blitted on redraws */
+#define MGUI_FLAG_STATIC LV_OBJ_FLAG_USER_1     // Set on objects that may be drawn into the static layer
+
+static lv_obj_t * static_layer = NULL;
+static lv_img_dsc_t static_dsc;
+static uint8_t * static_buf = NULL;
+static uint32_t static_buf_size = 0;
+
 /* Border for indicating disconnected WiFI, may be used for other applications as well */
 lv_obj_t * border;
 bool border_vis = false;
 
-/* LVGL styling */
-uint8_t font_sizes[] = {14, 18, 24, 32, 40};
-const lv_font_t *font_list[] = {&lv_font_montserrat_14, &lv_font_montserrat_18, &lv_font_montserrat_24, &lv_font_montserrat_32, &lv_font_montserrat_40};
+/* State of a Numeric, one fixed width cell per character so a new value only redraws the cells that changed */
+#define MGUI_NUMERIC_CELLS 12
+
+typedef struct {
+  char cells[MGUI_NUMERIC_CELLS + 1];   // Characters currently shown, right aligned
+  char unit[16];                        // Drawn after the cells, never changes
+  uint8_t width;                        // Number of reserved cells
+  uint8_t decimals;
+  bool zero_pad;
+  int32_t value;
+  lv_coord_t cell_w;                    // Width of the widest digit in the font
+} MGUI_numeric;
+
+/* LVGL styling, built-in fonts are only compiled in when fonts are not loaded from files */
+uint8_t font_sizes[] = {
+  14,
+#if LV_FONT_MONTSERRAT_18
+  18, 
+#endif
+#if LV_FONT_MONTSERRAT_24
+  24,
+#endif
+#if LV_FONT_MONTSERRAT_32
+  32,
+#endif
+#if LV_FONT_MONTSERRAT_40
+  40,
+#endif
+};
+const lv_font_t *font_list[] = {
+  &lv_font_montserrat_14,
+#if LV_FONT_MONTSERRAT_18
+  &lv_font_montserrat_18,
+#endif
+#if LV_FONT_MONTSERRAT_24
+  &lv_font_montserrat_24,
+#endif
+#if LV_FONT_MONTSERRAT_32
+  &lv_font_montserrat_32,
+#endif
+#if LV_FONT_MONTSERRAT_40
+  &lv_font_montserrat_40,
+#endif
+};
 
 /* MicroGUI object class functions */
 
@@ -99,6 +247,33 @@ char* MGUI_object::getParent() {
   return this->parent_id;
 }
 
+// Returns object's position in the object registry
+uint16_t MGUI_object::getIndex() {
+  return this->index;
+}
+
+void MGUI_object::setIndex(uint16_t idx) {
+  this->index = idx;
+}
+
+// Returns the state version of the latest change to this object
+uint32_t MGUI_object::getVersion() {
+  return this->version;
+}
+
+void MGUI_object::setVersion(uint32_t ver) {
+  this->version = ver;
+}
+
+// Returns widget specific state, e.g. the digits of a Numeric
+void * MGUI_object::getData() {
+  return this->data;
+}
+
+void MGUI_object::setData(void * ptr) {
+  this->data = ptr;
+}
+
 /* MicroGUI event class functions */
 
 MGUI_event::MGUI_event(const char * event, const char * parent, int val) {
@@ -139,19 +314,61 @@ void mgui_render_slider(JsonPair kv, JsonObject root);
 void mgui_render_checkbox(JsonPair kv, JsonObject root);
 void mgui_render_textfield(JsonPair kv, JsonObject root);
 void mgui_render_divider(JsonPair kv, JsonObject root);
+void mgui_render_numeric(JsonPair kv, JsonObject root);
+void mgui_render_image(JsonPair kv, JsonObject root);
+void mgui_render_table(JsonPair kv, JsonObject root);
+void mgui_render_chart(JsonPair kv, JsonObject root);
+void mgui_chart_drain();
+void mgui_bind_poll();
+void mgui_bind_reset();
+void mgui_dispatch_events();
+void mgui_events_init();
+
+void mgui_register_object(MGUI_object * object);
+void mgui_mark_changed(MGUI_object * object);
+void mgui_store_doc();
+static bool mgui_doc_reserve(size_t len);
+static bool mgui_doc_set(const char * json);
+static bool mgui_doc_write(DynamicJsonDocument & doc);
+const lv_font_t * mgui_font(uint8_t size);
+lv_style_t * mgui_style(MGUI_style_kind kind, lv_color_t color, uint8_t variant);
+void mgui_clear_styles();
+void mgui_drop_unused_styles();
+void mgui_cache_static();
+void mgui_mem_mark();
+void mgui_build_page(uint8_t page, JsonObject root);
+void mgui_evict_pages();
+void mgui_prebuild_page();
+void mgui_forget_object(MGUI_object * object);
+int32_t mgui_set_offpage(const char * obj_name, int value, const char * text);
+static uint32_t mgui_journal(uint16_t index);
+static void mgui_slot_keep(MGUI_object * object);
+static void mgui_slot_built(MGUI_object * object);
+static void mgui_slots_apply(JsonObject root);
+void mgui_make_dynamic(lv_obj_t * obj);
+void mgui_numeric_set(MGUI_object * object, int32_t value);
 
 /* Display function prototypes */
 void display_flush(lv_disp_drv_t *disp, const lv_area_t *area, lv_color_t *color_p);
+void display_monitor(lv_disp_drv_t *disp, uint32_t time, uint32_t px);
 void touchpad_read(lv_indev_drv_t *indev_driver, lv_indev_data_t *data);
+void mgui_touch_init(lv_indev_drv_t * indev_drv);
+void mgui_govern();
+void mgui_lcd_init();
 
 
 /* Parse json for important data in the beginning */
 void mgui_parse(char json[]) {
-  memcpy(document, json, strlen(json));   // Store a copy of the GUI document
+  if(json != document) mgui_doc_set(json);   // Store a copy of the GUI document
 
-  DynamicJsonDocument doc(sizeof(document));
+  // Only the size and color of the canvas are needed, the filter keeps the rest of the document out of the tree
+  StaticJsonDocument<128> filter;
+  filter["ROOT"]["props"]["width"] = true;
+  filter["ROOT"]["props"]["height"] = true;
+  filter["ROOT"]["props"]["background"] = true;
+  StaticJsonDocument<384> doc;
 
-  DeserializationError error = deserializeJson(doc, (const char*)document);
+  DeserializationError error = deserializeJson(doc, (const char*)json, DeserializationOption::Filter(filter));
   if(error) {
     Serial.print(F("deserializeJson() failed: "));
     Serial.println(error.f_str());
@@ -163,19 +380,31 @@ void mgui_parse(char json[]) {
   // Important data
   screenWidth = root["ROOT"]["props"]["width"];
   screenHeight = root["ROOT"]["props"]["height"];
+  canvas_color = lcd.color565(root["ROOT"]["props"]["background"]["r"], root["ROOT"]["props"]["background"]["g"], root["ROOT"]["props"]["background"]["b"]);
 
   doc.clear();
 }
 
 /* Initialize display for use with MicroGUI and render either a stored or the default GUI */ 
 void mgui_init() {
-  preferences.begin("gui", false);
-  String temp_doc = preferences.getString("main", "none");    // Get GUI stored in flash
-  preferences.end();
+  uint32_t start = millis();
+
+  // Read the GUI stored in flash straight into the document buffer
+  bool stored = false;
+  nvs_handle_t handle;
+  if(nvs_open("gui", NVS_READONLY, &handle) == ESP_OK) {
+    size_t len = 0;
+    if(nvs_get_str(handle, "main", NULL, &len) == ESP_OK && len > 1 && mgui_doc_reserve(len)) {
+      stored = nvs_get_str(handle, "main", document, &len) == ESP_OK;
+    }
+    nvs_close(handle);
+  }
+  boot.nvs_ms = millis() - start;
+
   // Set that as the main GUI document if it exists, otherwise set the default GUI as main document
-  if(!temp_doc.equals("none")) {
+  if(stored) {
     from_persistant = true;
-    mgui_init((char*)(temp_doc.c_str()));
+    mgui_init(document);
     return;
   }
 
@@ -199,10 +428,22 @@ void mgui_init(char json[]) {
 
 /* Initialize display for use with MicroGUI and render GUI */
 void mgui_init(char json[], int rotation) {
+  uint32_t start = millis();
   if(!screenWidth) mgui_parse(json);
-
-  lcd.init();   // Initialize LovyanGFX
+  boot.parse_ms = millis() - start;
+
+  start = millis();
+  mgui_lcd_init();
+  if(lcd_mutex == NULL) lcd_mutex = xSemaphoreCreateMutex();
+  mgui_events_init();
+  #if MGUI_FLUSH_DMA
+  lcd.initDMA();
+  #endif
+  boot.lcd_ms = millis() - start;
+
+  start = millis();
   lv_init();    // Initialize lvgl
+  mgui_image_init();
 
   // Setting display rotation
   if(rotation % 2 == 1 && screenWidth < screenHeight) {
@@ -215,6 +456,9 @@ void mgui_init(char json[], int rotation) {
     lcd.setRotation(rotation % 4);
   }
 
+  // Show the canvas right away, the widgets follow once rendered
+  lcd.fillScreen(canvas_color);
+
   /* LVGL : Setting up buffer to use for display */
   lv_disp_draw_buf_init(&draw_buf, buf, NULL, screenWidth * 10);
 
@@ -224,8 +468,9 @@ void mgui_init(char json[], int rotation) {
   disp_drv.hor_res = screenWidth;
   disp_drv.ver_res = screenHeight;
   disp_drv.flush_cb = display_flush;
+  disp_drv.monitor_cb = display_monitor;
   disp_drv.draw_buf = &draw_buf;
-  lv_disp_drv_register(&disp_drv);
+  disp = lv_disp_drv_register(&disp_drv);
 
   /* LVGL : Setup & Initialize the input device driver */
   static lv_indev_drv_t indev_drv;
@@ -233,21 +478,247 @@ void mgui_init(char json[], int rotation) {
   indev_drv.type = LV_INDEV_TYPE_POINTER;
   indev_drv.read_cb = touchpad_read;
   lv_indev_drv_register(&indev_drv);
+  touch_drv = &indev_drv;
+  mgui_touch_init(&indev_drv);
+  mgui_wake();
+  boot.lvgl_ms = millis() - start;
+
+  // Render main document, or the given one if there was no memory for a copy
+  start = millis();
+  mgui_render(document != NULL ? document : json);
+  boot.render_ms = millis() - start;
+
+  // Draw the first frame now instead of at the first mgui_run()
+  lv_refr_now(disp);
+  boot.first_frame_ms = millis();
+
+  char buf[100];
+  snprintf(buf, sizeof(buf), "[MicroGUI]: First frame after %lu ms", (unsigned long)boot.first_frame_ms);
+  Serial.println(buf);
+}
+
+/* Initialize LovyanGFX, with the board found at the previous boot if there is one */
+void mgui_lcd_init() {
+  preferences.begin("mgui", false);
+  lgfx::board_t board = (lgfx::board_t)preferences.getUInt("board", lgfx::board_unknown);
+
+  if(board != lgfx::board_unknown) {
+    lcd.setBoard(board);
+    boot.board_cached = lcd.init() && lcd.getBoard() == board;
+  }
+  if(!boot.board_cached) {
+    // Nothing stored or another board, detect it
+    lcd.setBoard(lgfx::board_unknown);
+    lcd.init();
+    if(lcd.getBoard() != board) preferences.putUInt("board", lcd.getBoard());
+  }
+  preferences.end();
+}
+
+/* Called by MicroGUI Remote once the web server is up */
+void mgui_boot_remote_ready() {
+  boot.remote_ms = millis();
+}
+
+/* Returns the time taken by each phase of booting */
+const MGUI_boot * mgui_get_boot() {
+  return &boot;
+}
+
+/* Event handlers, hashed by object name and event so that dispatching does not depend on the number of handlers */
+typedef struct MGUI_handler {
+  char parent[100];
+  char event[100];            // Empty for all events of the object
+  MGUI_event_cb cb;
+  void * arg;
+  bool worker;
+  struct MGUI_handler * next;
+} MGUI_handler;
+
+/* Handler call passed to the worker task */
+typedef struct {
+  MGUI_event_cb cb;
+  void * arg;
+  MGUI_event event;
+} MGUI_job;
+
+static MGUI_handler * handlers[MGUI_HANDLER_BUCKETS] = {NULL};
+static QueueHandle_t event_queue = NULL;
+static QueueHandle_t worker_queue = NULL;
+static TaskHandle_t worker_task = NULL;
+static bool worker_wanted = false;    // A handler on the worker was added
+
+static uint32_t mgui_hash(const char * str);
+
+static MGUI_handler ** mgui_handler_bucket(const char * parent, const char * event) {
+  return &handlers[(mgui_hash(parent) * 31 + mgui_hash(event)) % MGUI_HANDLER_BUCKETS];
+}
+
+static MGUI_handler * mgui_find_handler(const char * parent, const char * event) {
+  for(MGUI_handler * handler = *mgui_handler_bucket(parent, event); handler != NULL; handler = handler->next) {
+    if(mgui_compare(handler->parent, parent) && mgui_compare(handler->event, event)) return handler;
+  }
+  return NULL;
+}
+
+/* Runs handlers registered with worker set, one at a time */
+static void mgui_worker_task(void * param) {
+  MGUI_job job;
+  while(true) {
+    if(xQueueReceive(worker_queue, &job, portMAX_DELAY)) {
+      job.cb(&job.event, job.arg);
+    }
+  }
+}
+
+/* Start the worker task, once there is a queue for it */
+static bool mgui_start_worker() {
+  if(worker_task != NULL || worker_queue == NULL) return true;
+  if(xTaskCreate(mgui_worker_task, "mgui_worker", MGUI_WORKER_STACK, NULL, 1, &worker_task) != pdPASS) {
+    Serial.println("[MicroGUI]: Could not start the event worker");
+    return false;
+  }
+  return true;
+}
+
+/* Create the event queues, called by mgui_init() before any task can queue an event */
+void mgui_events_init() {
+  if(event_queue == NULL) event_queue = xQueueCreate(MGUI_EVENT_QUEUE, sizeof(MGUI_event));
+  if(worker_queue == NULL) worker_queue = xQueueCreate(MGUI_EVENT_QUEUE, sizeof(MGUI_job));
+  if(event_queue == NULL || worker_queue == NULL) {
+    Serial.println("[MicroGUI]: Out of memory, could not create the event queues");
+  }
+  if(worker_wanted) mgui_start_worker();
+}
+
+/* Call cb with arg on every event of an object, or only on the event given. Handlers are called from mgui_run(),
+   or with worker set from a separate task so that a slow handler does not hold up the display.
+   Handlers on the worker must not call other MicroGUI functions, use a bound variable to show results */
+bool mgui_on(const char * obj_name, const char * event, MGUI_event_cb cb, void * arg, bool worker) {
+  if(event == NULL) event = "";
+
+  // Before mgui_init() the worker is started together with the queues
+  if(worker) {
+    worker_wanted = true;
+    if(!mgui_start_worker()) return false;
+  }
+
+  MGUI_handler * handler = mgui_find_handler(obj_name, event);
+  if(handler == NULL) {
+    handler = (MGUI_handler*)calloc(1, sizeof(MGUI_handler));
+    if(handler == NULL) {
+      Serial.println("[MicroGUI]: Out of memory, could not add event handler");
+      return false;
+    }
+    strncpy(handler->parent, obj_name, sizeof(handler->parent) - 1);
+    strncpy(handler->event, event, sizeof(handler->event) - 1);
+
+    MGUI_handler ** bucket = mgui_handler_bucket(obj_name, event);
+    handler->next = *bucket;
+    *bucket = handler;
+  }
+
+  handler->cb = cb;
+  handler->arg = arg;
+  handler->worker = worker;
+  return true;
+}
+
+bool mgui_on(const char * obj_name, const char * event, MGUI_event_cb cb, void * arg) {
+  return mgui_on(obj_name, event, cb, arg, false);
+}
+
+bool mgui_on(const char * obj_name, MGUI_event_cb cb) {
+  return mgui_on(obj_name, NULL, cb, NULL, false);
+}
+
+/* Remove the handler of an object and event, NULL event for the handler of all events */
+void mgui_off(const char * obj_name, const char * event) {
+  if(event == NULL) event = "";
 
-  // Render main document
-  mgui_render(document);
+  for(MGUI_handler ** link = mgui_handler_bucket(obj_name, event); *link != NULL; link = &(*link)->next) {
+    if(mgui_compare((*link)->parent, obj_name) && mgui_compare((*link)->event, event)) {
+      MGUI_handler * handler = *link;
+      *link = handler->next;
+      free(handler);
+      return;
+    }
+  }
+}
+
+/* Queue an event for its' handlers, may be called from any task */
+void mgui_queue_event(const MGUI_event * event) {
+  if(event_queue == NULL) return;
+  if(xQueueSend(event_queue, event, 0) != pdTRUE) {
+    stats.events_dropped++;
+    Serial.println("[MicroGUI]: Event queue full, event dropped");
+    return;
+  }
+  stats.events++;
+}
+
+static void mgui_call_handler(MGUI_handler * handler, MGUI_event * event) {
+  if(handler == NULL) return;
+
+  if(handler->worker) {
+    MGUI_job job = {handler->cb, handler->arg, *event};
+    if(worker_task == NULL || xQueueSend(worker_queue, &job, 0) != pdTRUE) {
+      stats.events_dropped++;
+      Serial.println("[MicroGUI]: Event worker busy, event dropped");
+    }
+  }
+  else {
+    handler->cb(event, handler->arg);
+  }
+}
+
+/* Call the handlers of queued events, costs nothing when there are no events */
+void mgui_dispatch_events() {
+  MGUI_event event;
+  while(event_queue != NULL && xQueueReceive(event_queue, &event, 0) == pdTRUE) {
+    mgui_call_handler(mgui_find_handler(event.getParent(), event.getEvent()), &event);
+    if(event.getEvent()[0] != '\0') {
+      mgui_call_handler(mgui_find_handler(event.getParent(), ""), &event);
+    }
+  }
 }
 
 /* Let the display do its' work, returns a MicroGUI event */
 MGUI_event * mgui_run() {
+  // Adjust refresh rates and backlight to activity
+  mgui_govern();
+
+  // Show changes of bound variables
+  mgui_bind_poll();
+
+  // Plot samples pushed since the last run before LVGL draws
+  mgui_chart_drain();
+
   // LVGL tick function
   lv_timer_handler();
 
+  if(pending_page >= 0) {
+    mgui_show_page(pending_page);
+    pending_page = -1;
+  }
+  else if(prebuild_pending) {
+    mgui_prebuild_page();
+  }
+
   // Run DNS for captive portal if remote initialized
   if(getRemoteInit()) {
     mgui_run_captive();
   }
 
+  // Store a patched document once no patches have arrived for a while
+  if(doc_dirty && millis() - doc_dirty_time > MGUI_STORE_DELAY) {
+    doc_dirty = false;
+    mgui_store_doc();
+  }
+
+  // Run the handlers of events from the display and remote clients
+  mgui_dispatch_events();
+
   if(new_event) {      // Only return new events
     new_event = false;
 
@@ -291,6 +762,7 @@ static void widget_cb(lv_event_t * e) {
       latest = new MGUI_event(((MGUI_object*)lv_obj_get_user_data(object))->getEvent(), 
                               ((MGUI_object*)lv_obj_get_user_data(object))->getParent(), 
                               value);
+      mgui_bind_write(latest->getParent(), value);
       broadcast_event = false;            // Do not try to broadcast all slider value changes to avoid overloading the websocket connection. Only send final slider values, i.e. on slider release
     } 
     else if(lv_obj_check_type(object, &lv_switch_class) || lv_obj_check_type(object, &lv_checkbox_class)) {    // If switch or checkbox
@@ -298,6 +770,7 @@ static void widget_cb(lv_event_t * e) {
       latest = new MGUI_event(((MGUI_object*)lv_obj_get_user_data(object))->getEvent(), 
                               ((MGUI_object*)lv_obj_get_user_data(object))->getParent(), 
                               value);
+      mgui_bind_write(latest->getParent(), value);
     }
   }
   else if(code == LV_EVENT_RELEASED) {
@@ -309,13 +782,24 @@ static void widget_cb(lv_event_t * e) {
     } 
   }
   new_event = true;
+  mgui_queue_event(latest);
+
+  // Events named "page:N" switch page, which may delete the object, so it is done after the event
+  if(strncmp(latest->getEvent(), "page:", 5) == 0) {
+    pending_page = atoi(latest->getEvent() + 5);
+  }
+
+  // Record the state change for delta sync, same selection as for broadcasting
+  if(broadcast_event) {
+    mgui_mark_changed((MGUI_object*)lv_obj_get_user_data(object));
+  }
 
   // Broadcast change if remote is initialized
   if(getRemoteInit()) {
     if(broadcast_event) {
       char buf[100];
       sprintf(buf, "{\"%s\": %i}", ((MGUI_object*)lv_obj_get_user_data(object))->getParent(), value);
-      mgui_send(buf);
+      mgui_send((MGUI_object*)lv_obj_get_user_data(object), buf);
     }
   }
 }
@@ -341,6 +825,18 @@ void mgui_clear_lists() {
   for(int i = 0; i < dividers.size(); i++) {
     delete dividers.get(i);
   }
+  for(int i = 0; i < numerics.size(); i++) {
+    delete numerics.get(i);
+  }
+  for(int i = 0; i < images.size(); i++) {
+    delete images.get(i);
+  }
+  for(int i = 0; i < tables.size(); i++) {
+    delete tables.get(i);
+  }
+  for(int i = 0; i < charts.size(); i++) {
+    delete charts.get(i);
+  }
 
   // Clears object references from lists
   buttons.clear();
@@ -349,218 +845,1390 @@ void mgui_clear_lists() {
   checkboxes.clear();
   textfields.clear();
   dividers.clear();
+  numerics.clear();
+  images.clear();
+  tables.clear();
+  charts.clear();
+
+  registry_size = 0;
 }
 
-/* Render MicroGUI from json */
-void mgui_render(char json[]) {
-  DynamicJsonDocument doc(sizeof(document));
+/* Returns the list holding objects of a type, or NULL */
+LinkedList<MGUI_object*> * mgui_list(const char * type) {
+  if(mgui_compare(type, "Button")) return &buttons;
+  if(mgui_compare(type, "Switch")) return &switches;
+  if(mgui_compare(type, "Slider")) return &sliders;
+  if(mgui_compare(type, "Checkbox")) return &checkboxes;
+  if(mgui_compare(type, "Textfield")) return &textfields;
+  if(mgui_compare(type, "Divider")) return &dividers;
+  if(mgui_compare(type, "Numeric")) return &numerics;
+  if(mgui_compare(type, "Image")) return &images;
+  if(mgui_compare(type, "Table")) return &tables;
+  if(mgui_compare(type, "Chart")) return &charts;
+  return NULL;
+}
 
-  DeserializationError error = deserializeJson(doc, (const char*)json);
-  if(error) {
-    Serial.print(F("deserializeJson() failed: "));
-    Serial.println(error.f_str());
-    return;
+/* Add an object to the registry, giving it an index. NULL reserves an empty slot */
+void mgui_register_object(MGUI_object * object) {
+  if(registry_size == registry_capacity) {
+    uint16_t capacity = registry_capacity ? registry_capacity * 2 : 32;
+    MGUI_object ** temp = (MGUI_object**)realloc(registry, capacity * sizeof(MGUI_object*));
+    if(temp == NULL) {
+      Serial.println("[MicroGUI]: Out of memory, could not register object");
+      return;
+    }
+    registry = temp;
+    registry_capacity = capacity;
   }
+  if(object != NULL) {
+    object->setIndex(registry_size);
+    object->setVersion(journal_floor);
+  }
+  registry[registry_size++] = object;
+}
 
-  mgui_clear_lists();
-
-  JsonObject root = doc.as<JsonObject>();
-
-  // List all keys from the document
-  for(JsonPair kv : root) {
-    const char * type = (const char*)root[kv.key()]["type"]["resolvedName"];    // Find object type
+/* Start a new state epoch, all old journal entries refer to objects that no longer exist */
+void mgui_reset_journal() {
+  journal_head = 0;
+  journal_count = 0;
+  journal_floor = state_version;
+  state_epoch = esp_random();
+  mgui_remote_reset_subscriptions();
+}
 
-    // If object is the Canvas, i.e background
-    if(mgui_compare(type, "CanvasArea")) {
-      mgui_render_canvas(kv, root);
-    }
-    // If object is a button
-    else if(mgui_compare(type, "Button")) {
-      mgui_render_button(kv, root);
-    }
-    // If object is a switch
-    else if(mgui_compare(type, "Switch")) {
-      mgui_render_switch(kv, root);
-    }
-    // If object is a slider
-    else if(mgui_compare(type, "Slider")) {
-      mgui_render_slider(kv, root);
-    }
-    // If object is a checkbox
-    else if(mgui_compare(type, "Checkbox")) {
-      mgui_render_checkbox(kv, root);
-    }
-    // If object is a textfield
-    else if(mgui_compare(type, "Textfield")) {
-      mgui_render_textfield(kv, root);
-    }
-    // If object is a divider
-    else if(mgui_compare(type, "Divider")) {
-      mgui_render_divider(kv, root);
-    }
-  }
+/* Record that the state in a registry slot has changed, returns its new version */
+static uint32_t mgui_journal(uint16_t index) {
+  state_version++;
+  journal[journal_head].version = state_version;
+  journal[journal_head].index = index;
+  journal_head = (journal_head + 1) % MGUI_JOURNAL_SIZE;
+  if(journal_count < MGUI_JOURNAL_SIZE) journal_count++;
+  return state_version;
+}
 
-  Serial.println("[MicroGUI]: GUI successfully rendered!");
-  
-  // Try to store GUI in flash if canvas (ROOT) prop "persistant" is true
-  if(root["ROOT"]["props"]["persistant"] && !from_persistant) {
-    preferences.begin("gui", false);
-    preferences.clear();
-    
-    uint8_t status = preferences.putString("main", json);
-    if(!status) {
-      // If unsuccessful
-      Serial.println("[MicroGUI]: GUI was too large to be stored in persistant memory.");
-    } else {
-      // If successful
-      Serial.println("[MicroGUI]: Stored new GUI in persistant memory!");
-      memcpy(document, json, strlen(json));
-    }
+/* Record that the state of an object has changed */
+void mgui_mark_changed(MGUI_object * object) {
+  if(registry_size == 0 || object->getIndex() >= registry_size || registry[object->getIndex()] != object) return;
+  object->setVersion(mgui_journal(object->getIndex()));
+}
 
-    delay(50);
-    preferences.end();
-  }
+/* Returns the state version of a registry slot, of its object or of the value kept for it, 0 if it has neither */
+static uint32_t mgui_slot_version(uint16_t index) {
+  if(index < registry_size && registry[index] != NULL) return registry[index]->getVersion();
+  if(index < slot_count && slot_table[index].name != NULL) return slot_table[index].version;
+  return 0;
 }
 
-/* Search for an object in a list with corresponding name, linear search */
-MGUI_object * mgui_find_object(const char * obj_name, LinkedList<MGUI_object*> *list) {
-  for(int i = 0; i < list->size(); i++) {
-    if(strcmp(obj_name, list->get(i)->getParent()) == 0) {
-      return list->get(i);
-    }
-  }
-  return none_object;
+/* Free the values kept for objects that are not built */
+static void mgui_slot_clear(MGUI_slot * slot) {
+  free(slot->name);
+  free(slot->text);
+  slot->name = NULL;
+  slot->text = NULL;
 }
 
-/* Returns true if strings are equal and false if not, for strings less than 100 characters */
-bool mgui_compare(const char * string1, const char * string2) {
-  return !(strncmp(string1, string2, 100));
+/* Forget all slots, before a new document is rendered */
+static void mgui_slots_reset() {
+  for(uint16_t i = 0; i < slot_count; i++) mgui_slot_clear(&slot_table[i]);
+  free(slot_table);
+  slot_table = NULL;
+  slot_count = 0;
 }
 
-/* Set the value of a MicroGUI object */
-void mgui_set_value(const char * obj_name, int value) {
-  mgui_set_value(obj_name, value, true);
+/* Returns the kind of slot of an object type */
+static uint8_t mgui_slot_kind(const char * type) {
+  if(mgui_compare(type, "Textfield")) return MGUI_SLOT_TEXT;
+  if(mgui_compare(type, "Switch") || mgui_compare(type, "Checkbox")) return MGUI_SLOT_STATE;
+  if(mgui_compare(type, "Slider") || mgui_compare(type, "Numeric")) return MGUI_SLOT_VALUE;
+  return MGUI_SLOT_NONE;
 }
 
-void mgui_set_value(const char * obj_name, int value, bool send) {
-  // Find MicroGUI object
-  MGUI_object * object = mgui_find_object(obj_name, &textfields);
-  if(strcmp(object->getType(), "None") == 0) {
-    object = mgui_find_object(obj_name, &sliders);
-  }
-  if(strcmp(object->getType(), "None") == 0) {
-    object = mgui_find_object(obj_name, &switches);
+/* Make the slot table of a document, in the order mgui_build_page() gives out registry slots */
+static void mgui_slots_init(JsonObject root, uint16_t count) {
+  mgui_slots_reset();
+  if(count == 0) return;
+  slot_table = (MGUI_slot*)calloc(count, sizeof(MGUI_slot));
+  if(slot_table == NULL) {
+    Serial.println("[MicroGUI]: Out of memory, objects on pages that are not built can not be changed");
+    return;
   }
-  if(strcmp(object->getType(), "None") == 0) {
-    object = mgui_find_object(obj_name, &checkboxes);
+
+  for(JsonPair kv : root) {
+    const char * type = root[kv.key()]["type"]["resolvedName"] | "";
+    if(mgui_compare(type, "CanvasArea")) continue;
+    MGUI_slot * slot = &slot_table[slot_count++];
+    slot->name_hash = mgui_hash(kv.key().c_str());
+    slot->kind = mgui_slot_kind(type);
+    if(slot_count == count) break;
   }
+}
 
-  // Change its' value according to type
-  if(strcmp(object->getType(), "Textfield") == 0) {
-    String val = String(value);
-    char buf[16];
-    val.toCharArray(buf, 16);
-    mgui_set_text(obj_name, buf);
-    return;
-  } 
-  else if(strcmp(object->getType(), "Slider") == 0) {
-    lv_slider_set_value(object->getObject(), value, LV_ANIM_OFF);
-  } 
-  else if(strcmp(object->getType(), "Switch") == 0) {
-    if(value) lv_obj_add_state(object->getObject(), LV_STATE_CHECKED);
-    else lv_obj_clear_state(object->getObject(), LV_STATE_CHECKED);
-  } 
-  else if(strcmp(object->getType(), "Checkbox") == 0) {
-    if(value) lv_obj_add_state(object->getObject(), LV_STATE_CHECKED);
-    else lv_obj_clear_state(object->getObject(), LV_STATE_CHECKED);
-  } 
-  else {
-    Serial.print(F("[MicroGUI]: Could not change the value of "));
-    Serial.println(obj_name);
-    return;
+/* Returns the slot of an object in the document by its name, -1 if there is none */
+static int32_t mgui_find_slot(const char * obj_name) {
+  uint32_t hash = mgui_hash(obj_name);
+  for(uint16_t i = 0; i < slot_count && i < registry_size; i++) {
+    if(slot_table[i].name_hash == hash) return i;
   }
+  return -1;
+}
 
-  // Broadcast value change to connected WebSocket clients
-  if(getRemoteInit() && send) {
-    char buf[100];
-    sprintf(buf, "{\"%s\": %i}", obj_name, value);
-    //Serial.println(buf);
-    mgui_send(buf);
+/* Returns false if the object is in the document but its page is not built */
+static bool mgui_object_built(const char * obj_name) {
+  int32_t index = mgui_find_slot(obj_name);
+  return index < 0 || registry[index] != NULL;
+}
+
+/* Keep the value of an object whose page is torn down, if it has changed since the render */
+static void mgui_slot_keep(MGUI_object * object) {
+  uint16_t index = object->getIndex();
+  if(index >= slot_count || object->getVersion() <= journal_floor) return;
+  MGUI_slot * slot = &slot_table[index];
+  if(slot->kind == MGUI_SLOT_NONE) return;
+
+  mgui_slot_clear(slot);
+  slot->name = strdup(object->getParent());
+  if(slot->kind == MGUI_SLOT_TEXT) slot->text = strdup(lv_label_get_text(object->getObject()));
+  else slot->value = mgui_get_value(object->getParent());
+  if(slot->name == NULL || (slot->kind == MGUI_SLOT_TEXT && slot->text == NULL)) {
+    mgui_slot_clear(slot);
+    return;
   }
+  slot->version = object->getVersion();
 }
 
-/* Set the text of a MicroGUI object */
-void mgui_set_text(const char * obj_name, const char * text) {
-  mgui_set_text(obj_name, text, true);
+/* An object has been built in its slot from the document, it takes over the version of the value kept for it */
+static void mgui_slot_built(MGUI_object * object) {
+  uint16_t index = object->getIndex();
+  if(index >= slot_count || slot_table[index].name == NULL) return;
+  object->setVersion(slot_table[index].version);
+  mgui_slot_clear(&slot_table[index]);
 }
 
-void mgui_set_text(const char * obj_name, const char * text, bool send) {
-  // Find MicroGUI object, which has text
-  MGUI_object * object = mgui_find_object(obj_name, &textfields);
-  if(strcmp(object->getType(), "None") == 0) {
-    object = mgui_find_object(obj_name, &buttons);
+/* Write the values kept for objects that are not built into a document tree */
+static void mgui_slots_apply(JsonObject root) {
+  for(uint16_t i = 0; i < slot_count; i++) {
+    MGUI_slot * slot = &slot_table[i];
+    if(slot->name == NULL) continue;
+    JsonObject props = root[slot->name]["props"];
+    if(props.isNull()) continue;
+
+    if(slot->kind == MGUI_SLOT_TEXT) props["text"] = (const char*)slot->text;   // Not copied, the slot keeps it until its object is built
+    else if(slot->kind == MGUI_SLOT_STATE) props["state"] = slot->value;
+    else if(slot->kind == MGUI_SLOT_VALUE) props["value"] = slot->value;
   }
+}
 
-  // Change it's text according to type
-  if(strcmp(object->getType(), "Textfield") == 0) {
-    lv_label_set_text(object->getObject(), text);
+/* Call cb once for every registry slot changed after version since, returns false if the journal no longer covers since.
+   cb may be NULL to only check whether a delta is possible */
+bool mgui_for_each_change(uint32_t since, MGUI_slot_cb cb, void * arg) {
+  if(since < journal_floor || since > state_version) return false;
+  if(since == state_version) return true;
+
+  // Versions in the journal are consecutive, so the oldest one tells whether anything is missing
+  uint16_t oldest = (journal_head + MGUI_JOURNAL_SIZE - journal_count) % MGUI_JOURNAL_SIZE;
+  if(journal_count == 0 || journal[oldest].version > since + 1) return false;
+  if(cb == NULL) return true;
+
+  for(uint16_t i = 0; i < journal_count; i++) {
+    MGUI_change * change = &journal[(oldest + i) % MGUI_JOURNAL_SIZE];
+    if(change->version <= since) continue;
     
-    // Broadcast value change to connected WebSocket clients
-    if(getRemoteInit() && send) {
-      char buf[100];
-      sprintf(buf, "{\"%s\": \"%s\", \"type\": \"Textfield\"}", obj_name, text);
-      //Serial.println(buf);
-      mgui_send(buf);
+    // Only the latest change to each slot is reported
+    if(mgui_slot_version(change->index) == change->version) {
+      cb(change->index, arg);
     }
   }
-  else if(strcmp(object->getType(), "Button") == 0) {
-    Serial.println("[MicroGUI]: Updating text of buttons is not yet supported");
-    return;
-  } 
-  else {
-    Serial.print(F("[MicroGUI]: Could not change the text of "));
-    Serial.println(obj_name);
-    return;
+  return true;
+}
+
+/* Returns the number of registered objects */
+uint16_t mgui_object_count() {
+  return registry_size;
+}
+
+/* Call cb once for every registered object */
+void mgui_for_each_object(MGUI_object_cb cb, void * arg) {
+  for(uint16_t i = 0; i < registry_size; i++) {
+    if(registry[i] != NULL) cb(registry[i], arg);
   }
 }
 
-/* Get integer value of object */
-int mgui_get_value(const char * obj_name) {
-  // Search for object in relevant lists
-  MGUI_object * object = mgui_find_object(obj_name, &sliders);
-  // If not found ( object->getType() == "None" ) , try other list
-  if(strcmp(object->getType(), "None") == 0) {
-    object = mgui_find_object(obj_name, &switches);
+/* Returns the registered object at index, NULL if the slot is empty */
+MGUI_object * mgui_object_at(uint16_t index) {
+  return index < registry_size ? registry[index] : NULL;
+}
+
+/* Write src as the contents of a JSON string, cut short if it does not fit, returns the length written */
+static size_t mgui_json_escape(char * buf, size_t len, const char * src) {
+  size_t n = 0;
+  for(; *src; src++) {
+    char c = *src;
+    const char * esc = NULL;
+    if(c == '"') esc = "\\\"";
+    else if(c == '\\') esc = "\\\\";
+    else if(c == '\n') esc = "\\n";
+    else if(c == '\r') esc = "\\r";
+    else if(c == '\t') esc = "\\t";
+    else if((uint8_t)c < 0x20) continue;    // Other control characters are dropped
+
+    size_t need = esc != NULL ? 2 : 1;
+    if(n + need >= len) break;
+    if(esc != NULL) {
+      buf[n++] = esc[0];
+      buf[n++] = esc[1];
+    }
+    else {
+      buf[n++] = c;
+    }
   }
-  if(strcmp(object->getType(), "None") == 0) {
-    object = mgui_find_object(obj_name, &checkboxes);
+  if(len > 0) buf[n] = '\0';
+  return n;
+}
+
+/* Returns the length of src written as the contents of a JSON string */
+static size_t mgui_json_escaped_len(const char * src) {
+  size_t n = 0;
+  for(; *src; src++) {
+    char c = *src;
+    if(c == '"' || c == '\\' || c == '\n' || c == '\r' || c == '\t') n += 2;
+    else if((uint8_t)c >= 0x20) n++;
   }
+  return n;
+}
 
-  // Getting value from LVGL object types
-  if(strcmp(object->getType(), "Slider") == 0) {
-    return lv_slider_get_value(object->getObject());
+/* Write the text of a textfield as a WebSocket message, returns false if it did not fit */
+static bool mgui_text_message(const char * obj_name, const char * text, char * buf, size_t len) {
+  int n = snprintf(buf, len, "{\"%s\": \"", obj_name);
+  if(n < 0 || (size_t)n + mgui_json_escaped_len(text) >= len) return false;
+  n += mgui_json_escape(buf + n, len - n, text);
+  int m = snprintf(buf + n, len - n, "\", \"type\": \"Textfield\"}");
+  return m >= 0 && (size_t)(n + m) < len;
+}
+
+/* Write the current state of an object as a WebSocket message, returns false if the object has no state or it did not fit */
+bool mgui_state_message(MGUI_object * object, char * buf, size_t len) {
+  int n;
+  if(strcmp(object->getType(), "Textfield") == 0) {
+    return mgui_text_message(object->getParent(), lv_label_get_text(object->getObject()), buf, len);
   }
-  else if(strcmp(object->getType(), "Switch") == 0) {
-    return (int)lv_obj_get_state(object->getObject()) & LV_STATE_CHECKED ? 1 : 0;
+  else if(strcmp(object->getType(), "Slider") == 0) {
+    n = snprintf(buf, len, "{\"%s\": %i}", object->getParent(), (int)lv_slider_get_value(object->getObject()));
   }
-  else if(strcmp(object->getType(), "Checkbox") == 0) {
-    return (int)lv_obj_get_state(object->getObject()) & LV_STATE_CHECKED ? 1 : 0;
+  else if(strcmp(object->getType(), "Switch") == 0 || strcmp(object->getType(), "Checkbox") == 0) {
+    n = snprintf(buf, len, "{\"%s\": %i}", object->getParent(), (int)lv_obj_get_state(object->getObject()) & LV_STATE_CHECKED ? 1 : 0);
+  }
+  else if(strcmp(object->getType(), "Numeric") == 0) {
+    n = snprintf(buf, len, "{\"%s\": %li}", object->getParent(), (long)((MGUI_numeric*)object->getData())->value);
   }
   else {
-    Serial.print(F("[MicroGUI]: Could not get the value of "));
-    Serial.print(F(obj_name));
-    return -1;
+    return false;
   }
+  return n >= 0 && (size_t)n < len;
 }
 
-/* Update GUI document with latest values/states */
-void mgui_update_doc() {
-  DynamicJsonDocument doc(sizeof(document));
-
-  DeserializationError error = deserializeJson(doc, (const char*)document);
-  if(error) {
-    Serial.print(F("deserializeJson() failed: "));
-    Serial.println(error.f_str());
+/* Send the text of a textfield in a registry slot to the WebSocket clients subscribed to it */
+static void mgui_send_text(uint16_t index, const char * obj_name, const char * text) {
+  size_t len = strlen(obj_name) + mgui_json_escaped_len(text) + 32;
+  char * buf = (char*)malloc(len);
+  if(buf == NULL) {
+    Serial.println("[MicroGUI]: Out of memory, text change not sent");
+    return;
+  }
+  if(mgui_text_message(obj_name, text, buf, len)) mgui_send_slot(index, buf);
+  free(buf);
+}
+
+/* Write the state of a registry slot as a WebSocket message, returns false if it has none */
+bool mgui_slot_message(uint16_t index, char * buf, size_t len) {
+  if(index < registry_size && registry[index] != NULL) return mgui_state_message(registry[index], buf, len);
+  if(index >= slot_count || slot_table[index].name == NULL) return false;
+
+  MGUI_slot * slot = &slot_table[index];
+  if(slot->kind == MGUI_SLOT_TEXT) return mgui_text_message(slot->name, slot->text, buf, len);
+  int n = snprintf(buf, len, "{\"%s\": %i}", slot->name, slot->value);
+  return n >= 0 && (size_t)n < len;
+}
+
+/* Returns the size of buffer the state message of a registry slot needs, 0 if it has no state */
+size_t mgui_slot_message_size(uint16_t index) {
+  if(index < registry_size && registry[index] != NULL) {
+    MGUI_object * object = registry[index];
+    if(strcmp(object->getType(), "Textfield") == 0) {
+      return strlen(object->getParent()) + mgui_json_escaped_len(lv_label_get_text(object->getObject())) + 32;
+    }
+    if(strcmp(object->getType(), "Slider") != 0 && strcmp(object->getType(), "Switch") != 0 &&
+       strcmp(object->getType(), "Checkbox") != 0 && strcmp(object->getType(), "Numeric") != 0) return 0;
+    return strlen(object->getParent()) + 24;
+  }
+  if(index >= slot_count || slot_table[index].name == NULL) return 0;
+
+  MGUI_slot * slot = &slot_table[index];
+  if(slot->kind == MGUI_SLOT_TEXT) return strlen(slot->name) + mgui_json_escaped_len(slot->text) + 32;
+  return strlen(slot->name) + 24;
+}
+
+/* Call cb with every registry slot that has a state, built or not */
+void mgui_for_each_slot(MGUI_slot_cb cb, void * arg) {
+  for(uint16_t i = 0; i < registry_size; i++) {
+    if(registry[i] != NULL || (i < slot_count && slot_table[i].name != NULL)) cb(i, arg);
+  }
+}
+
+/* Returns the current state version */
+uint32_t mgui_state_version() {
+  return state_version;
+}
+
+/* Returns the current state epoch, changes whenever a GUI is rendered */
+uint32_t mgui_state_epoch() {
+  return state_epoch;
+}
+
+/* Write an object as a JSON member, "name": {"type": "Slider", "value": 50}, returns the length written or 0 if it did not fit */
+size_t mgui_widget_json(MGUI_object * object, char * buf, size_t len) {
+  int n = snprintf(buf, len, "\"%s\": {\"type\": \"%s\"", object->getParent(), object->getType());
+  if(n < 0 || (size_t)n >= len) return 0;
+
+  if(strcmp(object->getType(), "Textfield") == 0) {
+    int m = snprintf(buf + n, len - n, ", \"text\": \"");
+    if(m < 0 || (size_t)(n + m) >= len - 3) return 0;
+    n += m;
+    n += mgui_json_escape(buf + n, len - n - 2, lv_label_get_text(object->getObject()));
+    buf[n++] = '"';
+    buf[n] = '\0';
+  }
+  else if(strcmp(object->getType(), "Slider") == 0) {
+    n += snprintf(buf + n, len - n, ", \"value\": %i", (int)lv_slider_get_value(object->getObject()));
+  }
+  else if(strcmp(object->getType(), "Switch") == 0 || strcmp(object->getType(), "Checkbox") == 0) {
+    n += snprintf(buf + n, len - n, ", \"value\": %i", (lv_obj_get_state(object->getObject()) & LV_STATE_CHECKED) ? 1 : 0);
+  }
+  else if(strcmp(object->getType(), "Numeric") == 0) {
+    n += snprintf(buf + n, len - n, ", \"value\": %li", (long)((MGUI_numeric*)object->getData())->value);
+  }
+  if((size_t)n + 1 >= len) return 0;
+
+  buf[n++] = '}';
+  buf[n] = '\0';
+  return n;
+}
+
+/* FNV-1a hash of a string */
+static uint32_t mgui_hash(const char * str) {
+  uint32_t hash = 2166136261UL;
+  while(*str) {
+    hash ^= (uint8_t)*str++;
+    hash *= 16777619UL;
+  }
+  return hash;
+}
+
+/* Returns the content hash of the latest rendered GUI document */
+uint32_t mgui_document_hash() {
+  return document_hash;
+}
+
+/* Render a single object of the GUI document */
+void mgui_render_node(JsonPair kv, JsonObject root) {
+  const char * type = (const char*)root[kv.key()]["type"]["resolvedName"];    // Find object type
+
+  // If object is the Canvas, i.e background
+  if(mgui_compare(type, "CanvasArea")) {
+    mgui_render_canvas(kv, root);
+  }
+  // If object is a button
+  else if(mgui_compare(type, "Button")) {
+    mgui_render_button(kv, root);
+  }
+  // If object is a switch
+  else if(mgui_compare(type, "Switch")) {
+    mgui_render_switch(kv, root);
+  }
+  // If object is a slider
+  else if(mgui_compare(type, "Slider")) {
+    mgui_render_slider(kv, root);
+  }
+  // If object is a checkbox
+  else if(mgui_compare(type, "Checkbox")) {
+    mgui_render_checkbox(kv, root);
+  }
+  // If object is a textfield
+  else if(mgui_compare(type, "Textfield")) {
+    mgui_render_textfield(kv, root);
+  }
+  // If object is a divider
+  else if(mgui_compare(type, "Divider")) {
+    mgui_render_divider(kv, root);
+  }
+  // If object is a numeric display
+  else if(mgui_compare(type, "Numeric")) {
+    mgui_render_numeric(kv, root);
+  }
+  // If object is an image
+  else if(mgui_compare(type, "Image")) {
+    mgui_render_image(kv, root);
+  }
+  // If object is a table
+  else if(mgui_compare(type, "Table")) {
+    mgui_render_table(kv, root);
+  }
+  // If object is a chart
+  else if(mgui_compare(type, "Chart")) {
+    mgui_render_chart(kv, root);
+  }
+}
+
+/* Parsed JSON tree capacity for a document of len characters, strings are copied into the tree */
+size_t mgui_json_capacity(size_t len) {
+  return len * MGUI_JSON_FACTOR + 1024;
+}
+
+/* Allocate a document buffer, in PSRAM when enabled and available */
+static char * mgui_doc_alloc(size_t capacity) {
+  char * temp = NULL;
+  #if MGUI_DOC_PSRAM
+  temp = (char*)heap_caps_malloc(capacity, MALLOC_CAP_SPIRAM);
+  #endif
+  if(temp == NULL) temp = (char*)heap_caps_malloc(capacity, MALLOC_CAP_8BIT);
+  return temp;
+}
+
+/* Make room for a document of len characters, keeping the current one */
+static bool mgui_doc_reserve(size_t len) {
+  if(document != NULL && len < document_capacity) return true;
+
+  size_t capacity = len + 1 + MGUI_DOC_SLACK;
+  char * temp = mgui_doc_alloc(capacity);
+  if(temp == NULL) {
+    Serial.println("[MicroGUI]: Out of memory, GUI document too large");
+    return false;
+  }
+
+  temp[0] = '\0';
+  if(document != NULL) {
+    strcpy(temp, document);
+    heap_caps_free(document);
+  }
+  document = temp;
+  document_capacity = capacity;
+  return true;
+}
+
+/* Replace the document with a copy of json, a much smaller document gets a smaller buffer */
+static bool mgui_doc_set(const char * json) {
+  if(json == document) return true;
+
+  // The old buffer is only freed once the smaller one is allocated, otherwise the larger one is kept
+  size_t len = strlen(json);
+  if(document != NULL && len + 1 + MGUI_DOC_SLACK < document_capacity / 2) {
+    char * temp = mgui_doc_alloc(len + 1 + MGUI_DOC_SLACK);
+    if(temp != NULL) {
+      heap_caps_free(document);
+      document = temp;
+      document_capacity = len + 1 + MGUI_DOC_SLACK;
+    }
+  }
+  if(!mgui_doc_reserve(len)) return false;
+  memcpy(document, json, len + 1);
+  return true;
+}
+
+/* Serialize a document tree into the document, which is grown if needed */
+static bool mgui_doc_write(DynamicJsonDocument & doc) {
+  if(doc.overflowed() || !mgui_doc_reserve(measureJson(doc))) return false;
+  serializeJson(doc, document, document_capacity);
+  return true;
+}
+
+/* Store the GUI document in flash */
+void mgui_store_doc() {
+  preferences.begin("gui", false);
+  preferences.clear();
+  
+  uint8_t status = preferences.putString("main", document);
+  if(!status) {
+    // If unsuccessful
+    Serial.println("[MicroGUI]: GUI was too large to be stored in persistant memory.");
+  } else {
+    // If successful
+    Serial.println("[MicroGUI]: Stored new GUI in persistant memory!");
+  }
+
+  delay(50);
+  preferences.end();
+}
+
+/* Returns a font of the given size, loaded from file if possible, otherwise the closest built-in font */
+const lv_font_t * mgui_font(uint8_t size) {
+  const lv_font_t * font = mgui_font_file(size);
+  if(font != NULL) return font;
+
+  uint8_t i = 0;
+  while(i < sizeof font_sizes - 1 && size > font_sizes[i]) {
+    i++;
+  }
+  return font_list[i];
+}
+
+/* Returns the shared style for a kind, color and variant, it is created the first time it is asked for */
+lv_style_t * mgui_style(MGUI_style_kind kind, lv_color_t color, uint8_t variant) {
+  // Kinds without a color must not be told apart by one
+  uint32_t full = (kind == MGUI_STYLE_FONT || kind == MGUI_STYLE_PAD) ? 0 : color.full;
+
+  for(int i = 0; i < styles.size(); i++) {
+    MGUI_style * style = styles.get(i);
+    if(style->kind == kind && style->variant == variant && style->color == full) {
+      return &style->style;
+    }
+  }
+
+  MGUI_style * style = new MGUI_style;
+  style->kind = kind;
+  style->variant = variant;
+  style->color = full;
+  lv_style_init(&style->style);
+
+  switch(kind) {
+    case MGUI_STYLE_FLAT:
+      lv_style_set_bg_color(&style->style, color);
+      lv_style_set_border_width(&style->style, 0);
+      lv_style_set_radius(&style->style, 0);
+      break;
+    case MGUI_STYLE_BG:
+      lv_style_set_bg_color(&style->style, color);
+      break;
+    case MGUI_STYLE_BORDER:
+      lv_style_set_border_color(&style->style, color);
+      break;
+    case MGUI_STYLE_TEXT:
+      lv_style_set_text_color(&style->style, color);
+      break;
+    case MGUI_STYLE_FONT:
+      lv_style_set_text_font(&style->style, mgui_font(variant));
+      break;
+    case MGUI_STYLE_PAD:
+      lv_style_set_pad_all(&style->style, variant);
+      break;
+  }
+
+  styles.add(style);
+  return &style->style;
+}
+
+/* Free all shared styles, only allowed when no object uses them */
+void mgui_clear_styles() {
+  for(int i = 0; i < styles.size(); i++) {
+    lv_style_reset(&styles.get(i)->style);
+    delete styles.get(i);
+  }
+  styles.clear();
+}
+
+/* Mark the shared styles used by an object and its children */
+static void mgui_mark_styles(lv_obj_t * obj) {
+  for(uint32_t i = 0; i < obj->style_cnt; i++) {
+    for(int j = 0; j < styles.size(); j++) {
+      if(obj->styles[i].style == &styles.get(j)->style) styles.get(j)->used = true;
+    }
+  }
+  for(uint32_t i = 0; i < lv_obj_get_child_cnt(obj); i++) {
+    mgui_mark_styles(lv_obj_get_child(obj, i));
+  }
+}
+
+/* Free the shared styles no object uses anymore, so that patching in new colors does not add styles without end */
+void mgui_drop_unused_styles() {
+  for(int i = 0; i < styles.size(); i++) styles.get(i)->used = false;
+  for(uint8_t i = 0; i < page_count; i++) {
+    if(pages[i].screen != NULL) mgui_mark_styles(pages[i].screen);
+  }
+  mgui_mark_styles(lv_layer_top());
+
+  for(int i = styles.size() - 1; i >= 0; i--) {
+    if(styles.get(i)->used) continue;
+    lv_style_reset(&styles.get(i)->style);
+    delete styles.remove(i);
+  }
+}
+
+/* Render MicroGUI from json */
+void mgui_render(char json[]) {
+  DynamicJsonDocument doc(mgui_json_capacity(strlen(json)));
+
+  DeserializationError error = deserializeJson(doc, (const char*)json);
+  if(error) {
+    Serial.print(F("deserializeJson() failed: "));
+    Serial.println(error.f_str());
+    return;
+  }
+
+  JsonObject root = doc.as<JsonObject>();
+
+  // Every object gets a fixed registry slot, so that it keeps its index when its page is built again
+  uint16_t slots = 0;
+  uint16_t count = 1;
+  for(JsonPair kv : root) {
+    if(mgui_compare(root[kv.key()]["type"]["resolvedName"] | "", "CanvasArea")) continue;
+    int page = root[kv.key()]["props"]["page"] | 0;
+    if(page < 0 || page >= MGUI_MAX_PAGES) {
+      Serial.print(F("[MicroGUI]: Page out of range, GUI not rendered: "));
+      Serial.println(kv.key().c_str());
+      return;
+    }
+    if(page >= count) count = page + 1;
+    slots++;
+  }
+
+  // Keep a copy of the rendered GUI document, it is what patches and document requests work on
+  if(!mgui_doc_set(json)) {
+    Serial.println("[MicroGUI]: GUI is too large to keep a copy of, remote features will not work as expected");
+  }
+
+  // Show an empty screen while the previous GUI is deleted, before its styles are freed
+  lv_obj_t * old_screen = lv_scr_act();
+  build_screen = lv_obj_create(NULL);
+  lv_scr_load(build_screen);
+  static_layer = NULL;
+  for(uint8_t i = 0; i < page_count; i++) {
+    if(pages[i].screen != NULL) lv_obj_del(pages[i].screen);
+    if(pages[i].screen == old_screen) old_screen = NULL;
+  }
+  if(old_screen != NULL) lv_obj_del(old_screen);
+
+  mgui_clear_lists();
+  mgui_clear_styles();
+  mgui_reset_journal();
+  mgui_bind_reset();
+  document_hash = mgui_hash(json);
+  doc_dirty = false;
+
+  MGUI_page * temp = (MGUI_page*)realloc(pages, count * sizeof(MGUI_page));
+  if(temp == NULL && pages == NULL) {
+    Serial.println("[MicroGUI]: Out of memory, could not render GUI");
+    page_count = 0;
+    stats.page_count = 0;
+    stats.pages_built = 0;
+    return;
+  } else if(temp == NULL) {
+    Serial.println("[MicroGUI]: Out of memory, only the first page is shown");
+    count = 1;    // The old array has room for at least one page
+  } else {
+    pages = temp;
+  }
+  memset(pages, 0, count * sizeof(MGUI_page));
+  page_count = count;
+  stats.page_count = count;
+  stats.pages_built = 1;
+  active_page = 0;
+  pending_page = -1;
+
+  for(uint16_t i = 0; i < slots; i++) {
+    mgui_register_object(NULL);
+  }
+  mgui_slots_init(root, slots);
+
+  pages[0].screen = build_screen;
+  mgui_build_page(0, root);
+  mgui_cache_static();
+  mgui_mem_mark();
+  prebuild_pending = MGUI_PAGE_PREBUILD && page_count > 1;
+
+  Serial.println("[MicroGUI]: GUI successfully rendered!");
+  
+  // Try to store GUI in flash if canvas (ROOT) prop "persistant" is true
+  if(root["ROOT"]["props"]["persistant"] && !from_persistant) {
+    mgui_store_doc();
+  }
+}
+
+/* Render the objects of a page onto its screen, the canvas is on every page */
+void mgui_build_page(uint8_t page, JsonObject root) {
+  uint32_t start = millis();
+  if(pages[page].screen == NULL) {
+    pages[page].screen = lv_obj_create(NULL);
+    stats.pages_built++;
+  }
+  build_screen = pages[page].screen;
+
+  uint16_t slot = 0;
+  for(JsonPair kv : root) {
+    bool canvas = mgui_compare(root[kv.key()]["type"]["resolvedName"] | "", "CanvasArea");
+    if(canvas || (uint8_t)(root[kv.key()]["props"]["page"] | 0) == page) {
+      uint16_t size = registry_size;
+      mgui_render_node(kv, root);
+
+      // Move the new object from the end of the registry to its own slot
+      if(registry_size > size && slot < size) {
+        registry[slot] = registry[--registry_size];
+        registry[slot]->setIndex(slot);
+        mgui_slot_built(registry[slot]);
+      }
+    }
+    if(!canvas) slot++;
+  }
+
+  stats.page_builds++;
+  stats.last_build_ms = millis() - start;
+}
+
+/* Delete a built page that is not shown, with all of its objects */
+static void mgui_drop_page(uint8_t page) {
+  for(uint16_t i = 0; i < registry_size; i++) {
+    if(registry[i] != NULL && lv_obj_get_screen(registry[i]->getObject()) == pages[page].screen) {
+      mgui_slot_keep(registry[i]);
+      mgui_forget_object(registry[i]);
+    }
+  }
+  lv_obj_del(pages[page].screen);
+  pages[page].screen = NULL;
+  stats.pages_built--;
+  stats.page_evictions++;
+}
+
+/* Tear down the least recently used pages while too many are built or LVGL is short of memory */
+void mgui_evict_pages() {
+  bool saved = false;
+  while(true) {
+    int16_t oldest = -1;
+    uint8_t built = 0;
+    for(uint8_t i = 0; i < page_count; i++) {
+      if(pages[i].screen == NULL) continue;
+      built++;
+      if(i != active_page && (oldest < 0 || pages[i].last_used < pages[oldest].last_used)) oldest = i;
+    }
+
+    lv_mem_monitor_t mon;
+    lv_mem_monitor(&mon);
+    if(oldest < 0 || (built <= MGUI_PAGE_CACHE && mon.free_size >= MGUI_PAGE_MIN_FREE)) break;
+
+    // The page is built from the document again later, it has to remember the latest values
+    if(!saved) {
+      mgui_update_doc();
+      saved = true;
+    }
+    mgui_drop_page(oldest);
+  }
+}
+
+/* Show a page of the GUI, building it first if needed */
+void mgui_show_page(uint8_t page) {
+  if(page >= page_count || (page == active_page && pages[page].screen == lv_scr_act())) return;
+  uint32_t start = millis();
+
+  if(pages[page].screen == NULL) {
+    DynamicJsonDocument doc(mgui_json_capacity(strlen(document)));
+    DeserializationError error = deserializeJson(doc, (const char*)document);
+    if(error) {
+      Serial.print(F("deserializeJson() failed: "));
+      Serial.println(error.f_str());
+      return;
+    }
+    mgui_slots_apply(doc.as<JsonObject>());     // Values set while the page was not built
+    mgui_build_page(page, doc.as<JsonObject>());
+  }
+
+  active_page = page;
+  pages[page].last_used = millis();
+  lv_scr_load(pages[page].screen);
+  mgui_cache_static();
+  mgui_evict_pages();
+  mgui_mem_mark();
+  prebuild_pending = MGUI_PAGE_PREBUILD;
+
+  stats.page_switches++;
+  stats.last_switch_ms = millis() - start;
+  if(stats.last_switch_ms > stats.max_switch_ms) stats.max_switch_ms = stats.last_switch_ms;
+}
+
+/* Build one missing neighbour of the shown page, so that switching to it is fast */
+void mgui_prebuild_page() {
+  prebuild_pending = false;
+  for(int8_t step = 1; step >= -1; step -= 2) {
+    int16_t page = active_page + step;
+    if(page < 0 || page >= page_count || pages[page].screen != NULL) continue;
+
+    DynamicJsonDocument doc(mgui_json_capacity(strlen(document)));
+    if(deserializeJson(doc, (const char*)document)) return;
+    mgui_slots_apply(doc.as<JsonObject>());
+    mgui_build_page(page, doc.as<JsonObject>());
+    pages[page].last_used = millis();
+    mgui_evict_pages();
+
+    prebuild_pending = true;    // The other neighbour on the next run
+    return;
+  }
+}
+
+/* Returns the page currently shown */
+uint8_t mgui_get_page() {
+  return active_page;
+}
+
+/* Returns statistics about the GUI */
+const MGUI_stats * mgui_get_stats() {
+  stats.event_queue_depth = mgui_event_queue_depth();
+  return &stats;
+}
+
+/* Returns the statistics as they are, without changing them, for reading from other tasks than the GUI.
+   event_queue_depth is only kept by mgui_get_stats(), use mgui_event_queue_depth() */
+const MGUI_stats * mgui_stats_counters() {
+  return &stats;
+}
+
+/* Returns the number of events waiting for mgui_run(), may be called from any task */
+uint16_t mgui_event_queue_depth() {
+  return event_queue != NULL ? uxQueueMessagesWaiting(event_queue) : 0;
+}
+
+/* Start over the longest times in the statistics, e.g. for a replay */
+void mgui_stats_reset_max() {
+  stats.max_frame_ms = 0;
+  stats.max_switch_ms = 0;
+  stats.touch_wait_max_us = 0;
+}
+
+static MGUI_mem mem;
+
+/* Remember how much of LVGL's heap a rendered GUI takes */
+void mgui_mem_mark() {
+  lv_mem_monitor_t monitor;
+  lv_mem_monitor(&monitor);
+  mem.render_used = monitor.total_size - monitor.free_size;
+  if(mem.render_used > mem.render_max_used) mem.render_max_used = mem.render_used;
+  mem.renders++;
+}
+
+/* Count an LVGL object and all its' children */
+static uint32_t mgui_count_objects(lv_obj_t * obj) {
+  uint32_t count = 1;
+  for(uint32_t i = 0; i < lv_obj_get_child_cnt(obj); i++) {
+    count += mgui_count_objects(lv_obj_get_child(obj, i));
+  }
+  return count;
+}
+
+/* Returns the memory use of LVGL, the system and the GUI */
+const MGUI_mem * mgui_mem_report() {
+  lv_mem_monitor_t monitor;
+  lv_mem_monitor(&monitor);
+  mem.lvgl_total = monitor.total_size;
+  mem.lvgl_free = monitor.free_size;
+  mem.lvgl_biggest_free = monitor.free_biggest_size;
+  mem.lvgl_max_used = monitor.max_used;
+  mem.lvgl_used_pct = monitor.used_pct;
+  mem.lvgl_frag_pct = monitor.frag_pct;
+
+  mem.heap_total = heap_caps_get_total_size(MALLOC_CAP_INTERNAL);
+  mem.heap_free = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+  mem.heap_min_free = heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL);
+  mem.heap_biggest_free = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL);
+  mem.psram_total = heap_caps_get_total_size(MALLOC_CAP_SPIRAM);
+  mem.psram_free = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+  mem.psram_biggest_free = heap_caps_get_largest_free_block(MALLOC_CAP_SPIRAM);
+
+  mem.lvgl_objects = 0;
+  for(uint8_t i = 0; i < page_count; i++) {
+    if(pages[i].screen != NULL) mem.lvgl_objects += mgui_count_objects(pages[i].screen);
+  }
+  if(page_count > 0) mem.lvgl_objects += mgui_count_objects(lv_layer_top());
+
+  mem.textfields = textfields.size();
+  mem.buttons = buttons.size();
+  mem.switches = switches.size();
+  mem.sliders = sliders.size();
+  mem.checkboxes = checkboxes.size();
+  mem.dividers = dividers.size();
+  mem.numerics = numerics.size();
+  mem.images = images.size();
+  mem.tables = tables.size();
+  mem.charts = charts.size();
+  return &mem;
+}
+
+/* Print the memory report to serial */
+void mgui_mem_print() {
+  const MGUI_mem * report = mgui_mem_report();
+  char buf[120];
+
+  Serial.println("[MicroGUI]: Memory report");
+  snprintf(buf, sizeof(buf), "  LVGL: %u/%u bytes free, biggest block %u, %u%% fragmented, max used %u",
+           report->lvgl_free, report->lvgl_total, report->lvgl_biggest_free, report->lvgl_frag_pct, report->lvgl_max_used);
+  Serial.println(buf);
+  snprintf(buf, sizeof(buf), "  Renders: %u, used after latest %u, most %u",
+           report->renders, report->render_used, report->render_max_used);
+  Serial.println(buf);
+  snprintf(buf, sizeof(buf), "  Heap: %u/%u bytes free, lowest %u, biggest block %u",
+           report->heap_free, report->heap_total, report->heap_min_free, report->heap_biggest_free);
+  Serial.println(buf);
+  if(report->psram_total) {
+    snprintf(buf, sizeof(buf), "  PSRAM: %u/%u bytes free, biggest block %u", report->psram_free, report->psram_total, report->psram_biggest_free);
+    Serial.println(buf);
+  }
+  snprintf(buf, sizeof(buf), "  Objects: %u LVGL, %u textfields, %u buttons, %u switches, %u sliders, %u checkboxes",
+           report->lvgl_objects, report->textfields, report->buttons, report->switches, report->sliders, report->checkboxes);
+  Serial.println(buf);
+  snprintf(buf, sizeof(buf), "           %u dividers, %u numerics, %u images, %u tables, %u charts",
+           report->dividers, report->numerics, report->images, report->tables, report->charts);
+  Serial.println(buf);
+}
+
+/* Keep a value or text for an object on a page that is not built, returns its registry slot or -1 if there is no such object.
+   The value is journaled like a change of a built object, and written into the document when it is next parsed */
+int32_t mgui_set_offpage(const char * obj_name, int value, const char * text) {
+  int32_t index = mgui_find_slot(obj_name);
+  if(index < 0 || registry[index] != NULL) return -1;
+  MGUI_slot * slot = &slot_table[index];
+  if(slot->kind == MGUI_SLOT_NONE || (text != NULL && slot->kind != MGUI_SLOT_TEXT)) return -1;
+
+  char buf[12];
+  if(text == NULL && slot->kind == MGUI_SLOT_TEXT) {
+    snprintf(buf, sizeof(buf), "%i", value);
+    text = buf;
+  }
+
+  if(slot->name == NULL) {
+    slot->name = strdup(obj_name);
+    if(slot->name == NULL) return -1;
+  }
+  if(text != NULL) {
+    char * copy = strdup(text);
+    if(copy == NULL) return -1;
+    free(slot->text);
+    slot->text = copy;
+  }
+  else {
+    slot->value = slot->kind == MGUI_SLOT_STATE ? (value ? 1 : 0) : value;
+  }
+  slot->version = mgui_journal(index);
+  return index;
+}
+
+/* Forget a rendered object whose LVGL object is deleted elsewhere, its registry slot is left empty */
+void mgui_forget_object(MGUI_object * object) {
+  LinkedList<MGUI_object*> * list = mgui_list(object->getType());
+  for(int i = 0; list != NULL && i < list->size(); i++) {
+    if(list->get(i) == object) {
+      list->remove(i);
+      break;
+    }
+  }
+  registry[object->getIndex()] = NULL;
+  delete object;
+}
+
+/* Remove a rendered object and its LVGL object, its registry slot is left empty */
+void mgui_remove_object(MGUI_object * object) {
+  lv_obj_del(object->getObject());
+  mgui_forget_object(object);
+}
+
+/* Walk down a path of keys in the document tree */
+static JsonVariant mgui_patch_walk(JsonVariant node, char ** keys, uint8_t depth) {
+  if(depth == 0 || node.isNull()) return node;
+  if(node.is<JsonArray>()) return mgui_patch_walk(node[atoi(keys[0])], keys + 1, depth - 1);
+  return mgui_patch_walk(node[keys[0]], keys + 1, depth - 1);
+}
+
+/* Apply a JSON Patch style operation to the document tree, returns the name of the affected node or NULL on failure.
+   The path is split into segments, which the returned name points into */
+static const char * mgui_patch_apply(JsonVariant tree, JsonObject op, char * segments, size_t len) {
+  const char * kind = op["op"];
+  const char * path = op["path"];
+  if(kind == NULL || path == NULL || path[0] != '/') return NULL;
+
+  // Split the path into its segments, "/Slider_1/props/color" -> "Slider_1", "props", "color"
+  strncpy(segments, path + 1, len - 1);
+  segments[len - 1] = 0;
+
+  char * keys[8];
+  uint8_t depth = 0;
+  char * rest;
+  for(char * key = strtok_r(segments, "/", &rest); key != NULL && depth < 8; key = strtok_r(NULL, "/", &rest)) {
+    keys[depth++] = key;
+  }
+  if(depth == 0) return NULL;
+
+  // Walk down to the parent of the target
+  JsonVariant parent = mgui_patch_walk(tree, keys, depth - 1);
+  if(parent.isNull()) return NULL;
+  char * key = keys[depth - 1];     // Kept as char* so that ArduinoJson copies it into the document
+
+  if(mgui_compare(kind, "remove")) {
+    if(parent.is<JsonArray>()) parent.remove(atoi(key));
+    else parent.remove(key);
+  }
+  else if(mgui_compare(kind, "add") || mgui_compare(kind, "replace")) {
+    if(parent.is<JsonArray>()) {
+      if(strcmp(key, "-") == 0) parent.add(op["value"]);
+      else parent[atoi(key)] = op["value"];
+    } else {
+      parent[key] = op["value"];
+    }
+  }
+  else {
+    return NULL;
+  }
+
+  // Adding or removing a whole node also has to update the canvas' list of nodes
+  if(depth == 1 && !mgui_compare(keys[0], "ROOT")) {
+    JsonArray nodes = tree["ROOT"]["nodes"];
+    for(size_t i = 0; i < nodes.size(); i++) {
+      if(mgui_compare(nodes[i], keys[0])) {
+        nodes.remove(i);
+        break;
+      }
+    }
+    if(!mgui_compare(kind, "remove")) nodes.add(keys[0]);
+  }
+  return keys[0];
+}
+
+/* Re-render the object of a patched node if its page is built, in the registry slot and drawing order position of its
+   old object. Returns false if the object is new and had to be added at the end of the registry */
+static bool mgui_patch_object(JsonPair kv, JsonObject root, int32_t slot) {
+  const char * name = kv.key().c_str();
+
+  // The old object, in its slot or for objects added by earlier patches after the slots
+  int32_t old_index = slot >= 0 && registry[slot] != NULL ? slot : -1;
+  for(uint16_t j = slot_count; old_index < 0 && j < registry_size; j++) {
+    if(registry[j] != NULL && mgui_compare(registry[j]->getParent(), name)) old_index = j;
+  }
+  int32_t z_index = -1;
+  lv_obj_t * old_screen = NULL;
+  if(old_index >= 0) {
+    z_index = lv_obj_get_index(registry[old_index]->getObject());
+    old_screen = lv_obj_get_screen(registry[old_index]->getObject());
+    mgui_remove_object(registry[old_index]);
+  }
+  if(slot >= 0 && old_index < 0) old_index = slot;
+
+  // Objects on pages that are not built are built from the document with their page
+  uint8_t page = root[name]["props"]["page"] | 0;
+  if(page >= page_count || pages[page].screen == NULL) return true;
+
+  build_screen = pages[page].screen;
+  uint16_t size = registry_size;
+  mgui_render_node(kv, root);
+  if(registry_size == size) return true;
+  if(old_index < 0) return false;
+
+  registry[old_index] = registry[--registry_size];
+  registry[old_index]->setIndex(old_index);
+  if(build_screen == old_screen) lv_obj_move_to_index(registry[old_index]->getObject(), z_index);
+  mgui_mark_changed(registry[old_index]);     // Its state may have been patched too
+  return true;
+}
+
+/* Apply a patch, one or an array of {"op": "add"|"replace"|"remove", "path": "/<node>/...", "value": ...}, 
+   to the GUI document and re-render only the affected objects on built pages, the other pages pick up the changes
+   when they are built. The whole GUI is rendered again, on the page that was shown, when the canvas changes, when a
+   patch adds more than 8 new nodes, when a node is moved to a page the document did not have, or when nodes are added
+   to or removed from a document with several pages, as that changes the registry slots of its objects */
+bool mgui_patch_document(const char * patch) {
+  DynamicJsonDocument ops(strlen(patch) * 2 + 256);
+  DeserializationError error = deserializeJson(ops, patch);
+  if(error) {
+    Serial.print(F("deserializeJson() failed: "));
+    Serial.println(error.f_str());
+    return false;
+  }
+
+  DynamicJsonDocument doc(mgui_json_capacity(strlen(document) + strlen(patch)));
+  error = deserializeJson(doc, (const char*)document);
+  if(error) {
+    Serial.print(F("deserializeJson() failed: "));
+    Serial.println(error.f_str());
+    return false;
+  }
+  JsonObject root = doc.as<JsonObject>();
+  mgui_slots_apply(root);
+  for(uint16_t i = 0; i < slot_count; i++) slot_table[i].patched = false;
+  size_t node_count = root.size();
+
+  // Apply all operations to the document tree first, nothing on screen changes if any of them fails
+  JsonArray list = ops.is<JsonArray>() ? ops.as<JsonArray>() : JsonArray();
+  size_t count = ops.is<JsonArray>() ? list.size() : 1;
+  char added[8][100];       // Nodes without a registry slot
+  uint8_t added_count = 0;
+  bool render_all = false;
+
+  for(size_t i = 0; i < count; i++) {
+    JsonObject op = ops.is<JsonArray>() ? list[i].as<JsonObject>() : ops.as<JsonObject>();
+    char segments[100];
+    const char * node = mgui_patch_apply(doc.as<JsonVariant>(), op, segments, sizeof(segments));
+    if(node == NULL) {
+      Serial.println("[MicroGUI]: Invalid patch operation, patch not applied");
+      return false;
+    }
+
+    int32_t slot = mgui_find_slot(node);
+    if(mgui_compare(node, "ROOT")) {
+      render_all = true;
+    }
+    else if(slot >= 0) {
+      slot_table[slot].patched = true;
+    }
+    else {
+      bool seen = false;
+      for(uint8_t j = 0; j < added_count; j++) {
+        if(mgui_compare(added[j], node)) seen = true;
+      }
+      if(!seen && added_count == 8) {
+        render_all = true;
+      }
+      else if(!seen) {
+        strncpy(added[added_count], node, 99);
+        added[added_count++][99] = 0;
+      }
+    }
+  }
+
+  // Pages that the document does not have yet need a render, and so do changed registry slots of a paged document
+  if(page_count > 1 && root.size() != node_count) render_all = true;
+  for(JsonPair kv : root) {
+    int page = root[kv.key()]["props"]["page"] | 0;
+    if(page < 0 || page >= MGUI_MAX_PAGES) {
+      Serial.println("[MicroGUI]: Page out of range, patch not applied");
+      return false;
+    }
+    if(page >= page_count) render_all = true;
+  }
+
+  if(!mgui_doc_write(doc)) {
+    Serial.println("[MicroGUI]: Patched GUI is too large, patch not applied");
+    return false;
+  }
+
+  if(render_all) {
+    // Stored in flash below once the patches have settled, instead of right away by mgui_render()
+    uint8_t shown = active_page;
+    from_persistant = true;
+    mgui_render(document);
+    if(shown < page_count) mgui_show_page(shown);
+  }
+  else {
+    // Re-render the patched objects, values kept for objects that are not built no longer apply
+    bool slots_kept = true;     // Whether every object is still found at the same registry index
+    for(JsonPair kv : root) {
+      int32_t slot = mgui_find_slot(kv.key().c_str());
+      bool patched = slot >= 0 && slot_table[slot].patched;
+      for(uint8_t j = 0; slot < 0 && j < added_count; j++) {
+        if(mgui_compare(added[j], kv.key().c_str())) patched = true;
+      }
+      if(!patched) continue;
+
+      if(slot >= 0) {
+        slot_table[slot].patched = false;
+        slot_table[slot].kind = mgui_slot_kind(root[kv.key()]["type"]["resolvedName"] | "");
+        mgui_slot_clear(&slot_table[slot]);
+      }
+      if(!mgui_patch_object(kv, root, slot)) slots_kept = false;
+    }
+
+    // Nodes removed by the patch
+    for(uint16_t i = 0; i < slot_count; i++) {
+      if(!slot_table[i].patched) continue;
+      if(registry[i] != NULL) mgui_remove_object(registry[i]);
+      mgui_slot_clear(&slot_table[i]);
+      slot_table[i].patched = false;
+      slot_table[i].kind = MGUI_SLOT_NONE;
+      slot_table[i].name_hash = 0;
+    }
+    for(uint8_t i = 0; i < added_count; i++) {
+      if(!root[added[i]].isNull()) continue;
+      for(uint16_t j = slot_count; j < registry_size; j++) {
+        if(registry[j] != NULL && mgui_compare(registry[j]->getParent(), added[i])) mgui_remove_object(registry[j]);
+      }
+    }
+
+    mgui_cache_static();    // Removed objects may still be drawn into the static layer
+    mgui_drop_unused_styles();
+
+    // Clients keep their versions and subscriptions unless objects were added, the document itself has changed though
+    if(!slots_kept) mgui_reset_journal();
+    document_hash = mgui_hash(document);
+  }
+
+  // Writing to flash is slow, the persistant copy is updated once the patches have settled
+  if(root["ROOT"]["props"]["persistant"]) {
+    doc_dirty = true;
+    doc_dirty_time = millis();
+  }
+
+  Serial.println("[MicroGUI]: GUI successfully patched!");
+  return true;
+}
+
+/* Search for an object in a list with corresponding name, linear search */
+MGUI_object * mgui_find_object(const char * obj_name, LinkedList<MGUI_object*> *list) {
+  for(int i = 0; i < list->size(); i++) {
+    if(strcmp(obj_name, list->get(i)->getParent()) == 0) {
+      return list->get(i);
+    }
+  }
+  return none_object;
+}
+
+/* Returns true if strings are equal and false if not, for strings less than 100 characters */
+bool mgui_compare(const char * string1, const char * string2) {
+  return !(strncmp(string1, string2, 100));
+}
+
+/* Set the value of a MicroGUI object */
+void mgui_set_value(const char * obj_name, int value) {
+  mgui_set_value(obj_name, value, true);
+}
+
+void mgui_set_value(const char * obj_name, int value, bool send) {
+  int32_t index;
+
+  // Find MicroGUI object
+  MGUI_object * object = mgui_find_object(obj_name, &textfields);
+  if(strcmp(object->getType(), "None") == 0) {
+    object = mgui_find_object(obj_name, &sliders);
+  }
+  if(strcmp(object->getType(), "None") == 0) {
+    object = mgui_find_object(obj_name, &switches);
+  }
+  if(strcmp(object->getType(), "None") == 0) {
+    object = mgui_find_object(obj_name, &checkboxes);
+  }
+  if(strcmp(object->getType(), "None") == 0) {
+    object = mgui_find_object(obj_name, &numerics);
+  }
+
+  // Change its' value according to type
+  if(strcmp(object->getType(), "Textfield") == 0) {
+    char buf[12];
+    snprintf(buf, sizeof(buf), "%i", value);
+    mgui_set_text(obj_name, buf, send);
+    return;
+  } 
+  else if(strcmp(object->getType(), "Numeric") == 0) {
+    if(((MGUI_numeric*)object->getData())->value == value) return;
+    mgui_numeric_set(object, value);
+  }
+  else if(strcmp(object->getType(), "Slider") == 0) {
+    lv_slider_set_value(object->getObject(), value, LV_ANIM_OFF);
+  } 
+  else if(strcmp(object->getType(), "Switch") == 0) {
+    if(value) lv_obj_add_state(object->getObject(), LV_STATE_CHECKED);
+    else lv_obj_clear_state(object->getObject(), LV_STATE_CHECKED);
+  } 
+  else if(strcmp(object->getType(), "Checkbox") == 0) {
+    if(value) lv_obj_add_state(object->getObject(), LV_STATE_CHECKED);
+    else lv_obj_clear_state(object->getObject(), LV_STATE_CHECKED);
+  } 
+  else if((index = mgui_set_offpage(obj_name, value, NULL)) >= 0) {
+    // Object on a page that is not built, sent to the clients subscribed to its slot
+    if(getRemoteInit() && send) {
+      char buf[140];
+      if(mgui_slot_message(index, buf, sizeof(buf))) mgui_send_slot(index, buf);
+    }
+    return;
+  }
+  else {
+    Serial.print(F("[MicroGUI]: Could not change the value of "));
+    Serial.println(obj_name);
+    return;
+  }
+
+  mgui_mark_changed(object);
+
+  // Broadcast value change to connected WebSocket clients
+  if(getRemoteInit() && send) {
+    char buf[140];
+    snprintf(buf, sizeof(buf), "{\"%s\": %i}", obj_name, value);
+    //Serial.println(buf);
+    mgui_send(object, buf);
+  }
+}
+
+/* Set the text of a MicroGUI object */
+void mgui_set_text(const char * obj_name, const char * text) {
+  mgui_set_text(obj_name, text, true);
+}
+
+void mgui_set_text(const char * obj_name, const char * text, bool send) {
+  int32_t index;
+
+  // Find MicroGUI object, which has text
+  MGUI_object * object = mgui_find_object(obj_name, &textfields);
+  if(strcmp(object->getType(), "None") == 0) {
+    object = mgui_find_object(obj_name, &buttons);
+  }
+
+  // Change it's text according to type
+  if(strcmp(object->getType(), "Textfield") == 0) {
+    mgui_make_dynamic(object->getObject());
+    lv_label_set_text(object->getObject(), text);
+    mgui_mark_changed(object);
+    
+    // Broadcast value change to connected WebSocket clients
+    if(getRemoteInit() && send) {
+      mgui_send_text(object->getIndex(), obj_name, text);
+    }
+  }
+  else if(strcmp(object->getType(), "Button") == 0) {
+    Serial.println("[MicroGUI]: Updating text of buttons is not yet supported");
+    return;
+  } 
+  else if((index = mgui_set_offpage(obj_name, 0, text)) >= 0) {
+    if(getRemoteInit() && send) {
+      mgui_send_text(index, obj_name, text);
+    }
+  }
+  else {
+    Serial.print(F("[MicroGUI]: Could not change the text of "));
+    Serial.println(obj_name);
+    return;
+  }
+}
+
+/* Get integer value of object */
+int mgui_get_value(const char * obj_name) {
+  // Search for object in relevant lists
+  MGUI_object * object = mgui_find_object(obj_name, &sliders);
+  // If not found ( object->getType() == "None" ) , try other list
+  if(strcmp(object->getType(), "None") == 0) {
+    object = mgui_find_object(obj_name, &switches);
+  }
+  if(strcmp(object->getType(), "None") == 0) {
+    object = mgui_find_object(obj_name, &checkboxes);
+  }
+  if(strcmp(object->getType(), "None") == 0) {
+    object = mgui_find_object(obj_name, &numerics);
+  }
+
+  // Getting value from LVGL object types
+  if(strcmp(object->getType(), "Slider") == 0) {
+    return lv_slider_get_value(object->getObject());
+  }
+  else if(strcmp(object->getType(), "Switch") == 0) {
+    return (int)lv_obj_get_state(object->getObject()) & LV_STATE_CHECKED ? 1 : 0;
+  }
+  else if(strcmp(object->getType(), "Checkbox") == 0) {
+    return (int)lv_obj_get_state(object->getObject()) & LV_STATE_CHECKED ? 1 : 0;
+  }
+  else if(strcmp(object->getType(), "Numeric") == 0) {
+    return ((MGUI_numeric*)object->getData())->value;
+  }
+  else {
+    Serial.print(F("[MicroGUI]: Could not get the value of "));
+    Serial.print(F(obj_name));
+    return -1;
+  }
+}
+
+/* Update GUI document with latest values/states */
+void mgui_update_doc() {
+  DynamicJsonDocument doc(mgui_json_capacity(strlen(document)));
+
+  DeserializationError error = deserializeJson(doc, (const char*)document);
+  if(error) {
+    Serial.print(F("deserializeJson() failed: "));
+    Serial.println(error.f_str());
     return;
   }
 
@@ -579,202 +2247,1067 @@ void mgui_update_doc() {
   for(int i = 0; i < sliders.size(); i++) {
     root[sliders.get(i)->getParent()]["props"]["value"] = lv_slider_get_value(sliders.get(i)->getObject());
   }
+  for(int i = 0; i < numerics.size(); i++) {
+    root[numerics.get(i)->getParent()]["props"]["value"] = ((MGUI_numeric*)numerics.get(i)->getData())->value;
+  }
+  mgui_slots_apply(root);    // And the objects on pages that are not built
+
+  if(!mgui_doc_write(doc)) {
+    Serial.println("[MicroGUI]: Out of memory, GUI document not updated");
+  }
+  doc.clear();
+}
+
+/* Function for rendering a canvas */
+void mgui_render_canvas(JsonPair kv, JsonObject root) {
+  lv_obj_t * canvas = lv_obj_create(build_screen);
+  lv_obj_set_size(canvas, screenWidth, screenHeight);
+  lv_obj_align(canvas, LV_ALIGN_CENTER, 0, 0);
+  lv_obj_add_flag(canvas, MGUI_FLAG_STATIC);
+  lv_obj_add_style(canvas, mgui_style(MGUI_STYLE_FLAT, lv_color_make(root[kv.key()]["props"]["background"]["r"], root[kv.key()]["props"]["background"]["g"], root[kv.key()]["props"]["background"]["b"]), 0), 0);
+}
+
+/* Function for rendering a button */
+void mgui_render_button(JsonPair kv, JsonObject root) {
+  // Create LVGL object
+  lv_obj_t * button = lv_btn_create(build_screen);
+
+  // Create MGUI_object for newly created button
+  MGUI_object * m_button = new MGUI_object;
+  m_button->setObject(button);
+  memcpy(m_button->getType(), (const char*)root[kv.key()]["type"]["resolvedName"], strlen((const char*)root[kv.key()]["type"]["resolvedName"]));
+  memcpy(m_button->getParent(), kv.key().c_str(), strlen(kv.key().c_str()));
+  memcpy(m_button->getEvent(), (const char*)root[kv.key()]["props"]["event"], strlen((const char*)root[kv.key()]["props"]["event"]));
+
+  // Store MGUI_object pointer in linked list
+  buttons.add(m_button);
+  mgui_register_object(m_button);
+
+  // Store the MGUI object as user data
+  lv_obj_set_user_data(button, m_button);
+
+  // Add event callback
+  lv_obj_add_event_cb(button, widget_cb, LV_EVENT_CLICKED, NULL);   
+
+  // Styling
+  lv_obj_set_pos(button, root[kv.key()]["props"]["pageX"], root[kv.key()]["props"]["pageY"]);
+  lv_obj_set_height(button, LV_SIZE_CONTENT);
+  lv_obj_add_style(button, mgui_style(MGUI_STYLE_BG, lv_color_make(root[kv.key()]["props"]["background"]["r"], root[kv.key()]["props"]["background"]["g"], root[kv.key()]["props"]["background"]["b"]), 0), 0);
+  
+  // Add label to button
+  lv_obj_t * label = lv_label_create(button);
+  const char* text = root[kv.key()]["props"]["text"];
+  lv_label_set_text(label, text);
+  lv_obj_center(label);
+  lv_obj_add_style(label, mgui_style(MGUI_STYLE_TEXT, lv_color_make(root[kv.key()]["props"]["color"]["r"], root[kv.key()]["props"]["color"]["g"], root[kv.key()]["props"]["color"]["b"]), 0), 0);
+}
+
+/* Function for rendering a switch */
+void mgui_render_switch(JsonPair kv, JsonObject root) {
+  lv_obj_t * sw = lv_switch_create(build_screen);
+  
+  MGUI_object * m_switch = new MGUI_object;
+  m_switch->setObject(sw);
+  memcpy(m_switch->getType(), (const char*)root[kv.key()]["type"]["resolvedName"], strlen((const char*)root[kv.key()]["type"]["resolvedName"]));
+  memcpy(m_switch->getParent(), kv.key().c_str(), strlen(kv.key().c_str()));
+  memcpy(m_switch->getEvent(), (const char*)root[kv.key()]["props"]["event"], strlen((const char*)root[kv.key()]["props"]["event"]));
+
+  switches.add(m_switch);
+  mgui_register_object(m_switch);
+  lv_obj_set_user_data(sw, m_switch);
+  lv_obj_add_event_cb(sw, widget_cb, LV_EVENT_VALUE_CHANGED, NULL);
+  
+  if(root[kv.key()]["props"]["state"]) {
+    lv_obj_add_state(sw, LV_STATE_CHECKED);
+  }
+
+  // Styling
+  lv_obj_set_pos(sw, root[kv.key()]["props"]["pageX"], root[kv.key()]["props"]["pageY"]);
+  lv_obj_add_style(sw, mgui_style(MGUI_STYLE_BG, lv_color_make(188, 188, 188), 0), LV_PART_MAIN | LV_STATE_DEFAULT);
+  lv_obj_add_style(sw, mgui_style(MGUI_STYLE_BG, lv_color_make(root[kv.key()]["props"]["color"]["r"], root[kv.key()]["props"]["color"]["g"], root[kv.key()]["props"]["color"]["b"]), 0), LV_PART_INDICATOR | LV_STATE_CHECKED);
+
+  if(mgui_compare((const char*)root[kv.key()]["props"]["size"], "medium")) {
+    lv_obj_set_height(sw, (lv_coord_t)25);
+    lv_obj_set_width(sw, (lv_coord_t)56);
+    lv_obj_add_style(sw, mgui_style(MGUI_STYLE_PAD, lv_color_black(), 4), LV_PART_KNOB);
+  } else {
+    lv_obj_set_height(sw, (lv_coord_t)20);
+    lv_obj_set_width(sw, (lv_coord_t)44);
+    lv_obj_add_style(sw, mgui_style(MGUI_STYLE_PAD, lv_color_black(), 3), LV_PART_KNOB);
+  }
+}
+
+/* Function for rendering a slider */
+void mgui_render_slider(JsonPair kv, JsonObject root) {
+  lv_obj_t * slider = lv_slider_create(build_screen);
+
+  MGUI_object * m_slider = new MGUI_object;
+  m_slider->setObject(slider);
+  memcpy(m_slider->getType(), (const char*)root[kv.key()]["type"]["resolvedName"], strlen((const char*)root[kv.key()]["type"]["resolvedName"]));
+  memcpy(m_slider->getParent(), kv.key().c_str(), strlen(kv.key().c_str()));
+  memcpy(m_slider->getEvent(), (const char*)root[kv.key()]["props"]["event"], strlen((const char*)root[kv.key()]["props"]["event"]));
+
+  sliders.add(m_slider);
+  mgui_register_object(m_slider);
+  lv_obj_set_user_data(slider, m_slider);
+  lv_obj_add_event_cb(slider, widget_cb, LV_EVENT_VALUE_CHANGED, NULL);   // LV_EVENT_ALL did not work, hence the two callback setups
+  lv_obj_add_event_cb(slider, widget_cb, LV_EVENT_RELEASED, NULL);
+
+  // Styling
+  lv_obj_set_width(slider, root[kv.key()]["props"]["width"]);
+  lv_obj_set_pos(slider, root[kv.key()]["props"]["pageX"], root[kv.key()]["props"]["pageY"]);
+  lv_slider_set_range(slider, root[kv.key()]["props"]["min"], root[kv.key()]["props"]["max"]);
+  lv_slider_set_value(slider, root[kv.key()]["props"]["value"], LV_ANIM_OFF);
+  lv_style_t * style = mgui_style(MGUI_STYLE_BG, lv_color_make(root[kv.key()]["props"]["color"]["r"], root[kv.key()]["props"]["color"]["g"], root[kv.key()]["props"]["color"]["b"]), 0);
+  lv_obj_add_style(slider, style, LV_PART_INDICATOR);
+  lv_obj_add_style(slider, style, LV_PART_KNOB);
+}
+
+/* Function for rendering a checkbox */
+void mgui_render_checkbox(JsonPair kv, JsonObject root) {
+  lv_obj_t * checkbox = lv_checkbox_create(build_screen);
+
+  MGUI_object * m_checkbox = new MGUI_object;
+  m_checkbox->setObject(checkbox);
+  memcpy(m_checkbox->getType(), (const char*)root[kv.key()]["type"]["resolvedName"], strlen((const char*)root[kv.key()]["type"]["resolvedName"]));
+  memcpy(m_checkbox->getParent(), kv.key().c_str(), strlen(kv.key().c_str()));
+  memcpy(m_checkbox->getEvent(), (const char*)root[kv.key()]["props"]["event"], strlen((const char*)root[kv.key()]["props"]["event"]));
+
+  checkboxes.add(m_checkbox);
+  mgui_register_object(m_checkbox);
+  lv_obj_set_user_data(checkbox, m_checkbox);
+  lv_obj_add_event_cb(checkbox, widget_cb, LV_EVENT_VALUE_CHANGED, NULL);
+
+  if(root[kv.key()]["props"]["state"]) {
+    lv_obj_add_state(checkbox, LV_STATE_CHECKED);
+  }
+
+  // Styling
+  lv_obj_set_pos(checkbox, root[kv.key()]["props"]["pageX"], root[kv.key()]["props"]["pageY"]);
+  lv_checkbox_set_text(checkbox, "");
+  lv_obj_add_style(checkbox, mgui_style(MGUI_STYLE_BORDER, lv_color_make(root[kv.key()]["props"]["color"]["r"], root[kv.key()]["props"]["color"]["g"], root[kv.key()]["props"]["color"]["b"]), 0), LV_PART_INDICATOR);
+  lv_obj_add_style(checkbox, mgui_style(MGUI_STYLE_BG, lv_color_make(255, 255, 255), 0), LV_PART_INDICATOR | LV_STATE_DEFAULT);
+  lv_obj_add_style(checkbox, mgui_style(MGUI_STYLE_BG, lv_color_make(root[kv.key()]["props"]["color"]["r"], root[kv.key()]["props"]["color"]["g"], root[kv.key()]["props"]["color"]["b"]), 0), LV_PART_INDICATOR | LV_STATE_CHECKED);
+  
+  if(mgui_compare((const char*)root[kv.key()]["props"]["size"], "medium")) {
+    lv_obj_add_style(checkbox, mgui_style(MGUI_STYLE_FONT, lv_color_black(), 24), 0);   // Sets checkbox size
+  }
+}
+
+/* Function for rendering a textfield */
+void mgui_render_textfield(JsonPair kv, JsonObject root) {
+  lv_obj_t * textfield = lv_label_create(build_screen);
+
+  MGUI_object * m_textfield = new MGUI_object;
+  m_textfield->setObject(textfield);
+  memcpy(m_textfield->getType(), (const char*)root[kv.key()]["type"]["resolvedName"], strlen((const char*)root[kv.key()]["type"]["resolvedName"]));
+  memcpy(m_textfield->getParent(), kv.key().c_str(), strlen(kv.key().c_str()));
+  memcpy(m_textfield->getEvent(), "NoInput", strlen("NoInput"));
+
+  textfields.add(m_textfield);
+  mgui_register_object(m_textfield);
+  lv_obj_set_user_data(textfield, m_textfield);
+  lv_obj_add_flag(textfield, MGUI_FLAG_STATIC);    // Until its text is set
+
+  // Styling
+  lv_obj_set_pos(textfield, root[kv.key()]["props"]["pageX"], root[kv.key()]["props"]["pageY"]);
+  const char* text = root[kv.key()]["props"]["text"];
+  lv_label_set_text(textfield, text);
+  lv_obj_add_style(textfield, mgui_style(MGUI_STYLE_TEXT, lv_color_make(root[kv.key()]["props"]["color"]["r"], root[kv.key()]["props"]["color"]["g"], root[kv.key()]["props"]["color"]["b"]), 0), 0);
+
+  uint8_t fontSize = (uint8_t)root[kv.key()]["props"]["fontSize"];
+  lv_obj_add_style(textfield, mgui_style(MGUI_STYLE_FONT, lv_color_black(), fontSize), 0);   // Sets font size
+}
+
+/* Function for rendering a divider */
+void mgui_render_divider(JsonPair kv, JsonObject root) {
+  lv_obj_t * divider = lv_obj_create(build_screen);
+
+  MGUI_object * m_divider = new MGUI_object;
+  m_divider->setObject(divider);
+  memcpy(m_divider->getType(), (const char*)root[kv.key()]["type"]["resolvedName"], strlen((const char*)root[kv.key()]["type"]["resolvedName"]));
+  memcpy(m_divider->getParent(), kv.key().c_str(), strlen(kv.key().c_str()));
+  memcpy(m_divider->getEvent(), "NoInput", strlen("NoInput"));
+
+  dividers.add(m_divider);
+  mgui_register_object(m_divider);
+  lv_obj_set_user_data(divider, m_divider);
+
+  int height = (int)root[kv.key()]["props"]["thickness"];
+  int width = (int)root[kv.key()]["props"]["length"];
+
+  if(mgui_compare(root[kv.key()]["props"]["orientation"], "vertical")) {
+    int temp = height;
+    height = width;
+    width = temp;
+  }
+
+  lv_obj_set_size(divider, width, height);
+  lv_obj_align(divider, LV_ALIGN_TOP_LEFT, (lv_coord_t)root[kv.key()]["props"]["pageX"], (lv_coord_t)root[kv.key()]["props"]["pageY"]);
+  lv_obj_add_flag(divider, MGUI_FLAG_STATIC);
+  lv_obj_add_style(divider, mgui_style(MGUI_STYLE_FLAT, lv_color_make(root[kv.key()]["props"]["color"]["r"], root[kv.key()]["props"]["color"]["g"], root[kv.key()]["props"]["color"]["b"]), 0), 0);
+  lv_obj_set_scrollbar_mode(divider, LV_SCROLLBAR_MODE_OFF);
+}
+
+/* Function for rendering an image */
+void mgui_render_image(JsonPair kv, JsonObject root) {
+  lv_obj_t * image = lv_img_create(build_screen);
+
+  const char * event = root[kv.key()]["props"]["event"] | "NoInput";
+  MGUI_object * m_image = new MGUI_object;
+  m_image->setObject(image);
+  memcpy(m_image->getType(), (const char*)root[kv.key()]["type"]["resolvedName"], strlen((const char*)root[kv.key()]["type"]["resolvedName"]));
+  memcpy(m_image->getParent(), kv.key().c_str(), strlen(kv.key().c_str()));
+  strncpy(m_image->getEvent(), event, 99);
+
+  images.add(m_image);
+  mgui_register_object(m_image);
+  lv_obj_set_user_data(image, m_image);
+
+  // Images with an event act as buttons, the others never change
+  if(mgui_compare(event, "NoInput")) {
+    lv_obj_add_flag(image, MGUI_FLAG_STATIC);
+  } else {
+    lv_obj_add_flag(image, LV_OBJ_FLAG_CLICKABLE);
+    lv_obj_add_event_cb(image, widget_cb, LV_EVENT_CLICKED, NULL);
+  }
+
+  const void * src = mgui_image_src(root[kv.key()]["props"]["src"]);
+  if(src == NULL) {
+    Serial.print(F("[MicroGUI]: Could not find image "));
+    Serial.println((const char*)root[kv.key()]["props"]["src"]);
+  } else {
+    lv_img_set_src(image, src);
+  }
+
+  lv_obj_set_pos(image, root[kv.key()]["props"]["pageX"], root[kv.key()]["props"]["pageY"]);
+}
+
+/* Table rows, kept by object name so that they outlive the Table itself, e.g. when its page is torn down */
+#define MGUI_TABLE_COLUMNS 8
+
+typedef struct {
+  char name[100];
+  MGUI_table_cb cb;           // Application data source, rows are taken from the ring when NULL
+  uint32_t rows;
+  char ** ring;               // Rows added with mgui_table_add_row, cells separated by tabs
+  uint32_t ring_head;         // Oldest row
+} MGUI_table_data;
+
+LinkedList<MGUI_table_data*> table_data;
+
+/* State of a rendered Table, only the rows in view have objects, which are reused as the table is scrolled.
+   The Table scrolls by itself, LVGL coordinates are too small for thousands of rows */
+typedef struct {
+  MGUI_table_data * data;
+  lv_obj_t * body;
+  lv_obj_t ** pool;           // Row objects with one label per column
+  int32_t * pool_rows;        // Row shown by each row object, -1 if hidden
+  uint8_t pool_size;
+  uint8_t columns;
+  lv_coord_t col_x[MGUI_TABLE_COLUMNS + 1];
+  lv_coord_t row_h;
+  uint32_t offset;            // Scroll position in pixels
+  int32_t drag;               // Distance dragged since pressed, to tell drags from clicks
+} MGUI_table;
+
+/* Find the rows of a table by name, optionally creating them */
+static MGUI_table_data * mgui_table_data(const char * name, bool create) {
+  for(int i = 0; i < table_data.size(); i++) {
+    if(mgui_compare(table_data.get(i)->name, name)) return table_data.get(i);
+  }
+  if(!create) return NULL;
+
+  MGUI_table_data * data = (MGUI_table_data*)calloc(1, sizeof(MGUI_table_data));
+  if(data == NULL) return NULL;
+  strncpy(data->name, name, sizeof(data->name) - 1);
+  table_data.add(data);
+  return data;
+}
+
+/* Returns the text of a cell */
+static const char * mgui_table_cell(MGUI_table_data * data, uint32_t row, uint8_t column, char * buf, size_t len) {
+  if(data->cb != NULL) return data->cb(row, column, buf, len);
+  if(data->ring == NULL || row >= data->rows) return "";
+
+  const char * cell = data->ring[(data->ring_head + row) % MGUI_TABLE_RING_SIZE];
+  for(uint8_t i = 0; i < column && cell != NULL; i++) {
+    cell = strchr(cell, '\t');
+    if(cell != NULL) cell++;
+  }
+  if(cell == NULL) return "";
+
+  size_t n = strcspn(cell, "\t");
+  if(n >= len) n = len - 1;
+  memcpy(buf, cell, n);
+  buf[n] = '\0';
+  return buf;
+}
+
+static uint32_t mgui_table_max_offset(MGUI_table * table) {
+  uint32_t total = table->data->rows * table->row_h;
+  uint32_t view = lv_obj_get_height(table->body);
+  return total > view ? total - view : 0;
+}
+
+/* Place the row objects over the rows in view, a row object is only refilled when it gets another row or refill is set */
+static void mgui_table_update(MGUI_table * table, bool refill) {
+  if(table->pool_size == 0) return;
+  uint32_t first = table->offset / table->row_h;
+  char buf[64];
+
+  for(uint32_t row = first; row < first + table->pool_size; row++) {
+    uint8_t slot = row % table->pool_size;
+    lv_obj_t * obj = table->pool[slot];
+
+    if(row >= table->data->rows) {
+      if(table->pool_rows[slot] != -1) {
+        lv_obj_add_flag(obj, LV_OBJ_FLAG_HIDDEN);
+        table->pool_rows[slot] = -1;
+      }
+      continue;
+    }
+
+    if(table->pool_rows[slot] != (int32_t)row || refill) {
+      for(uint8_t c = 0; c < table->columns; c++) {
+        lv_label_set_text(lv_obj_get_child(obj, c), mgui_table_cell(table->data, row, c, buf, sizeof(buf)));
+      }
+      table->pool_rows[slot] = row;
+      lv_obj_clear_flag(obj, LV_OBJ_FLAG_HIDDEN);
+    }
+    lv_obj_set_y(obj, (lv_coord_t)(row * table->row_h - table->offset));
+  }
+}
+
+/* Scroll a table to an offset in pixels, limited to its rows */
+static void mgui_table_scroll(MGUI_table * table, int64_t offset) {
+  uint32_t max = mgui_table_max_offset(table);
+  uint32_t clamped = offset < 0 ? 0 : (offset > max ? max : (uint32_t)offset);
+  if(clamped == table->offset) return;
+  table->offset = clamped;
+  mgui_table_update(table, false);
+  lv_obj_invalidate(table->body);     // For the scroll indicator
+}
+
+/* Show new rows in the rendered Table of a name, if there is one */
+static void mgui_table_changed(const char * name, bool follow) {
+  MGUI_object * object = mgui_find_object(name, &tables);
+  if(strcmp(object->getType(), "Table") != 0) return;
+  MGUI_table * table = (MGUI_table*)object->getData();
+
+  // A table scrolled to its end stays there, like a log
+  if(follow) table->offset = mgui_table_max_offset(table);
+  else if(table->offset > mgui_table_max_offset(table)) table->offset = mgui_table_max_offset(table);
+  mgui_table_update(table, true);
+  lv_obj_invalidate(table->body);
+}
+
+/* Show rows from an application callback in a table */
+void mgui_table_set_source(const char * obj_name, MGUI_table_cb cb, uint32_t rows) {
+  MGUI_table_data * data = mgui_table_data(obj_name, true);
+  if(data == NULL) return;
+  data->cb = cb;
+  data->rows = rows;
+  mgui_table_changed(obj_name, false);
+}
+
+/* Change the number of rows of a table with a callback source */
+void mgui_table_set_rows(const char * obj_name, uint32_t rows) {
+  MGUI_table_data * data = mgui_table_data(obj_name, false);
+  if(data == NULL || data->cb == NULL) return;
+  data->rows = rows;
+  mgui_table_changed(obj_name, false);
+}
+
+/* Add a row to the end of a table, cells separated by tabs. The oldest row is dropped when MGUI_TABLE_RING_SIZE rows are kept */
+void mgui_table_add_row(const char * obj_name, const char * cells) {
+  MGUI_table_data * data = mgui_table_data(obj_name, true);
+  if(data == NULL) return;
+  if(data->ring == NULL) {
+    data->ring = (char**)calloc(MGUI_TABLE_RING_SIZE, sizeof(char*));
+    if(data->ring == NULL) {
+      Serial.println("[MicroGUI]: Out of memory, could not add table row");
+      return;
+    }
+  }
+
+  MGUI_object * object = mgui_find_object(obj_name, &tables);
+  bool follow = strcmp(object->getType(), "Table") == 0 && ((MGUI_table*)object->getData())->offset >= mgui_table_max_offset((MGUI_table*)object->getData());
+
+  uint32_t slot = (data->ring_head + data->rows) % MGUI_TABLE_RING_SIZE;
+  if(data->rows == MGUI_TABLE_RING_SIZE) {
+    free(data->ring[slot]);
+    data->ring_head = (data->ring_head + 1) % MGUI_TABLE_RING_SIZE;
+  } else {
+    data->rows++;
+  }
+  data->ring[slot] = strdup(cells);
+
+  mgui_table_changed(obj_name, follow);
+}
+
+/* Refill the rows in view, after the data behind a callback source has changed */
+void mgui_table_refresh(const char * obj_name) {
+  mgui_table_changed(obj_name, false);
+}
+
+/* Scrolling, row clicks, scroll indicator and cleanup of a Table */
+static void table_cb(lv_event_t * e) {
+  MGUI_table * table = (MGUI_table*)lv_event_get_user_data(e);
+  lv_event_code_t code = lv_event_get_code(e);
+
+  if(code == LV_EVENT_PRESSED) {
+    table->drag = 0;
+  }
+  else if(code == LV_EVENT_PRESSING) {
+    lv_point_t vect;
+    lv_indev_get_vect(lv_indev_get_act(), &vect);
+    table->drag += abs(vect.y);
+    mgui_table_scroll(table, (int64_t)table->offset - vect.y);
+  }
+  else if(code == LV_EVENT_CLICKED && table->drag < 5) {
+    lv_point_t point;
+    lv_area_t coords;
+    lv_indev_get_point(lv_indev_get_act(), &point);
+    lv_obj_get_coords(table->body, &coords);
+    uint32_t row = (point.y - coords.y1 + table->offset) / table->row_h;
+    if(row >= table->data->rows) return;
+
+    MGUI_object * object = (MGUI_object*)lv_obj_get_user_data(lv_obj_get_parent(table->body));
+    if(mgui_compare(object->getEvent(), "NoInput")) return;
+    delete latest;
+    latest = new MGUI_event(object->getEvent(), object->getParent(), row);
+    new_event = true;
+    mgui_queue_event(latest);
+  }
+  else if(code == LV_EVENT_DRAW_POST) {
+    uint32_t max = mgui_table_max_offset(table);
+    if(max == 0) return;
+
+    lv_area_t coords;
+    lv_obj_get_coords(table->body, &coords);
+    lv_coord_t view = lv_area_get_height(&coords);
+    lv_coord_t thumb = LV_MAX(view * view / (max + view), 10);
+
+    lv_draw_rect_dsc_t dsc;
+    lv_draw_rect_dsc_init(&dsc);
+    dsc.bg_color = lv_obj_get_style_text_color(table->body, LV_PART_MAIN);
+    dsc.bg_opa = LV_OPA_50;
+    dsc.radius = 2;
+
+    lv_area_t bar;
+    bar.x2 = coords.x2 - 1;
+    bar.x1 = bar.x2 - 3;
+    bar.y1 = coords.y1 + (int64_t)(view - thumb) * table->offset / max;
+    bar.y2 = bar.y1 + thumb - 1;
+    lv_draw_rect(lv_event_get_draw_ctx(e), &dsc, &bar);
+  }
+  else if(code == LV_EVENT_DELETE) {
+    free(table->pool);
+    free(table->pool_rows);
+    free(table);
+  }
+}
+
+/* Function for rendering a table */
+void mgui_render_table(JsonPair kv, JsonObject root) {
+  MGUI_table * state = (MGUI_table*)calloc(1, sizeof(MGUI_table));
+  MGUI_table_data * data = mgui_table_data(kv.key().c_str(), true);
+  if(state == NULL || data == NULL) {
+    free(state);
+    Serial.println("[MicroGUI]: Out of memory, could not render table");
+    return;
+  }
+  state->data = data;
+
+  lv_obj_t * table = lv_obj_create(build_screen);
+
+  const char * event = root[kv.key()]["props"]["event"] | "NoInput";
+  MGUI_object * m_table = new MGUI_object;
+  m_table->setObject(table);
+  memcpy(m_table->getType(), (const char*)root[kv.key()]["type"]["resolvedName"], strlen((const char*)root[kv.key()]["type"]["resolvedName"]));
+  memcpy(m_table->getParent(), kv.key().c_str(), strlen(kv.key().c_str()));
+  strncpy(m_table->getEvent(), event, 99);
+  m_table->setData(state);
+
+  tables.add(m_table);
+  mgui_register_object(m_table);
+  lv_obj_set_user_data(table, m_table);
+
+  // Styling, text styles are inherited by the cells
+  lv_coord_t width = root[kv.key()]["props"]["width"] | 200;
+  lv_coord_t height = root[kv.key()]["props"]["height"] | 150;
+  uint8_t fontSize = (uint8_t)root[kv.key()]["props"]["fontSize"];
+  lv_obj_set_pos(table, root[kv.key()]["props"]["pageX"], root[kv.key()]["props"]["pageY"]);
+  lv_obj_set_size(table, width, height);
+  lv_obj_clear_flag(table, LV_OBJ_FLAG_SCROLLABLE);
+  lv_obj_add_style(table, mgui_style(MGUI_STYLE_FLAT, lv_color_make(root[kv.key()]["props"]["background"]["r"], root[kv.key()]["props"]["background"]["g"], root[kv.key()]["props"]["background"]["b"]), 0), 0);
+  lv_obj_add_style(table, mgui_style(MGUI_STYLE_PAD, lv_color_black(), 0), 0);
+  lv_obj_add_style(table, mgui_style(MGUI_STYLE_TEXT, lv_color_make(root[kv.key()]["props"]["color"]["r"], root[kv.key()]["props"]["color"]["g"], root[kv.key()]["props"]["color"]["b"]), 0), 0);
+  lv_obj_add_style(table, mgui_style(MGUI_STYLE_FONT, lv_color_black(), fontSize), 0);
+
+  state->row_h = root[kv.key()]["props"]["rowHeight"] | (int)(lv_font_get_line_height(mgui_font(fontSize)) + 4);
+  if(state->row_h < 1) state->row_h = 1;
+
+  // Columns, of equal width unless given
+  JsonArray columns = root[kv.key()]["props"]["columns"];
+  state->columns = constrain((int)columns.size(), 1, MGUI_TABLE_COLUMNS);
+  bool titles = false;
+  for(uint8_t c = 0; c < state->columns; c++) {
+    lv_coord_t w = columns[c]["width"] | (int)(width / state->columns);
+    state->col_x[c + 1] = state->col_x[c] + w;
+    if(columns[c]["title"]) titles = true;
+  }
+
+  lv_coord_t header_h = titles ? state->row_h : 0;
+  for(uint8_t c = 0; titles && c < state->columns; c++) {
+    lv_obj_t * title = lv_label_create(table);
+    lv_label_set_text(title, columns[c]["title"] | "");
+    lv_label_set_long_mode(title, LV_LABEL_LONG_CLIP);
+    lv_obj_set_pos(title, state->col_x[c] + 2, 2);
+    lv_obj_set_width(title, state->col_x[c + 1] - state->col_x[c] - 4);
+  }
+
+  state->body = lv_obj_create(table);
+  lv_obj_remove_style_all(state->body);
+  lv_obj_clear_flag(state->body, LV_OBJ_FLAG_SCROLLABLE);
+  lv_obj_set_pos(state->body, 0, header_h);
+  lv_obj_set_size(state->body, width, height - header_h);
+  lv_obj_add_event_cb(state->body, table_cb, LV_EVENT_ALL, state);
+
+  // Enough row objects to cover the body when the top row is partly scrolled out
+  uint16_t pool_size = (height - header_h) / state->row_h + 2;
+  state->pool_size = pool_size > 255 ? 255 : pool_size;
+  state->pool = (lv_obj_t**)calloc(state->pool_size, sizeof(lv_obj_t*));
+  state->pool_rows = (int32_t*)calloc(state->pool_size, sizeof(int32_t));
+  if(state->pool == NULL || state->pool_rows == NULL) {
+    state->pool_size = 0;
+    Serial.println("[MicroGUI]: Out of memory, table rows can not be shown");
+    return;
+  }
+
+  for(uint8_t i = 0; i < state->pool_size; i++) {
+    lv_obj_t * row = lv_obj_create(state->body);
+    lv_obj_remove_style_all(row);
+    lv_obj_clear_flag(row, LV_OBJ_FLAG_CLICKABLE | LV_OBJ_FLAG_SCROLLABLE);
+    lv_obj_add_flag(row, LV_OBJ_FLAG_HIDDEN);
+    lv_obj_set_size(row, width, state->row_h);
+    for(uint8_t c = 0; c < state->columns; c++) {
+      lv_obj_t * cell = lv_label_create(row);
+      lv_label_set_long_mode(cell, LV_LABEL_LONG_CLIP);
+      lv_obj_set_pos(cell, state->col_x[c] + 2, 2);
+      lv_obj_set_width(cell, state->col_x[c + 1] - state->col_x[c] - 4);
+    }
+    state->pool[i] = row;
+    state->pool_rows[i] = -1;
+  }
+
+  mgui_table_update(state, true);
+}
+
+/* Charts, samples pass through a single producer single consumer ring so that a sensor task can push without locking */
+#if (MGUI_CHART_RING_SIZE & (MGUI_CHART_RING_SIZE - 1)) != 0
+#error "MGUI_CHART_RING_SIZE must be a power of two"
+#endif
+
+typedef struct MGUI_chart_view MGUI_chart_view;
+
+struct MGUI_chart {
+  char name[100];
+  float ring[MGUI_CHART_RING_SIZE];
+  uint32_t head;              // Only written by the producer
+  uint32_t tail;              // Only written by mgui_run()
+  MGUI_chart_view * view;     // Rendered Chart, NULL while not built
+};
+
+/* State of a rendered Chart. The plot is an image one pixel column per decimated group of samples,
+   which is scrolled in memory and gets only the new columns drawn */
+struct MGUI_chart_view {
+  MGUI_chart * chart;
+  lv_obj_t * obj;
+  lv_img_dsc_t img;
+  lv_color_t * pixels;
+  int16_t * columns;          // Lowest and highest y of columns not yet drawn, two per column
+  uint32_t new_columns;
+  lv_coord_t w;
+  lv_coord_t h;
+  float min;
+  float max;
+  uint16_t decimation;        // Samples per pixel column
+  uint16_t count;             // Samples in the column being collected
+  float col_min;
+  float col_max;
+  float last;                 // Last sample of the previous column
+  bool has_last;
+  lv_color_t color;
+  lv_color_t background;
+};
+
+LinkedList<MGUI_chart*> chart_data;
+
+/* Returns the chart handle of an object name, it stays valid for the lifetime of the program.
+   Get handles before pushing from other tasks, as creating one is not thread safe */
+MGUI_chart * mgui_chart(const char * obj_name) {
+  for(int i = 0; i < chart_data.size(); i++) {
+    if(mgui_compare(chart_data.get(i)->name, obj_name)) return chart_data.get(i);
+  }
+
+  MGUI_chart * chart = (MGUI_chart*)calloc(1, sizeof(MGUI_chart));
+  if(chart == NULL) {
+    Serial.println("[MicroGUI]: Out of memory, could not create chart");
+    return NULL;
+  }
+  strncpy(chart->name, obj_name, sizeof(chart->name) - 1);
+  chart_data.add(chart);
+  return chart;
+}
+
+/* Push samples to a chart, returns how many fit in the ring. Never blocks, may be called from any one task */
+uint32_t mgui_chart_push(MGUI_chart * chart, const float * samples, uint32_t n) {
+  if(chart == NULL) return 0;
+
+  uint32_t head = chart->head;
+  uint32_t tail = __atomic_load_n(&chart->tail, __ATOMIC_ACQUIRE);
+  uint32_t space = MGUI_CHART_RING_SIZE - (head - tail);
+  if(n > space) n = space;
+
+  for(uint32_t i = 0; i < n; i++) {
+    chart->ring[(head + i) & (MGUI_CHART_RING_SIZE - 1)] = samples[i];
+  }
+  __atomic_store_n(&chart->head, head + n, __ATOMIC_RELEASE);
+  return n;
+}
+
+/* Pixel row of a value, clamped to the plot */
+static int16_t mgui_chart_y(MGUI_chart_view * view, float value) {
+  float y = (view->h - 1) - (value - view->min) * (view->h - 1) / (view->max - view->min);
+  if(y < 0) return 0;
+  if(y > view->h - 1) return view->h - 1;
+  return (int16_t)y;
+}
+
+/* Scroll the plot left by the new columns and draw only those */
+static void mgui_chart_scroll(MGUI_chart_view * view) {
+  uint32_t n = view->new_columns < (uint32_t)view->w ? view->new_columns : view->w;
+  uint32_t first = view->new_columns > (uint32_t)view->w ? view->new_columns % view->w : 0;
+
+  for(lv_coord_t y = 0; y < view->h; y++) {
+    lv_color_t * row = view->pixels + y * view->w;
+    memmove(row, row + n, (view->w - n) * sizeof(lv_color_t));
+    for(uint32_t k = 0; k < n; k++) {
+      int16_t * column = view->columns + ((first + k) % view->w) * 2;
+      row[view->w - n + k] = (y >= column[0] && y <= column[1]) ? view->color : view->background;
+    }
+  }
 
-  serializeJson(root, document);
-  doc.clear();
+  view->new_columns = 0;
+  lv_obj_invalidate(view->obj);
 }
 
-/* Function for rendering a canvas */
-void mgui_render_canvas(JsonPair kv, JsonObject root) {
-  lv_obj_t * canvas = lv_obj_create(lv_scr_act());
-  lv_obj_set_size(canvas, screenWidth, screenHeight);
-  lv_obj_align(canvas, LV_ALIGN_CENTER, 0, 0);
-  lv_obj_set_style_bg_color(canvas, lv_color_make(root[kv.key()]["props"]["background"]["r"], root[kv.key()]["props"]["background"]["g"], root[kv.key()]["props"]["background"]["b"]), 0);
-  lv_obj_set_style_border_width(canvas, 0, 0);
-  lv_obj_set_style_border_width(canvas, 0, 0);
-  lv_obj_set_style_radius(canvas, 0, 0);
-}
+/* Move pushed samples into the rendered charts, samples of charts that are not built are dropped */
+void mgui_chart_drain() {
+  for(int i = 0; i < chart_data.size(); i++) {
+    MGUI_chart * chart = chart_data.get(i);
+    uint32_t head = __atomic_load_n(&chart->head, __ATOMIC_ACQUIRE);
+    MGUI_chart_view * view = chart->view;
+
+    for(uint32_t tail = chart->tail; view != NULL && tail != head; tail++) {
+      float value = chart->ring[tail & (MGUI_CHART_RING_SIZE - 1)];
+      if(view->count == 0) {
+        view->col_min = value;
+        view->col_max = value;
+      }
+      else {
+        if(value < view->col_min) view->col_min = value;
+        if(value > view->col_max) view->col_max = value;
+      }
+      if(++view->count < view->decimation) continue;
+
+      // Reach back to the previous column so that steep edges stay connected
+      float low = view->col_min;
+      float high = view->col_max;
+      if(view->has_last) {
+        if(view->last < low) low = view->last;
+        if(view->last > high) high = view->last;
+      }
+      view->last = value;
+      view->has_last = true;
+      view->count = 0;
+
+      int16_t * column = view->columns + (view->new_columns % view->w) * 2;
+      column[0] = mgui_chart_y(view, high);
+      column[1] = mgui_chart_y(view, low);
+      view->new_columns++;
+    }
+    __atomic_store_n(&chart->tail, head, __ATOMIC_RELEASE);
 
-/* Function for rendering a button */
-void mgui_render_button(JsonPair kv, JsonObject root) {
-  // Create LVGL object
-  lv_obj_t * button = lv_btn_create(lv_scr_act());
+    if(view != NULL && view->new_columns > 0) {
+      mgui_chart_scroll(view);
+    }
+  }
+}
 
-  // Create MGUI_object for newly created button
-  MGUI_object * m_button = new MGUI_object;
-  m_button->setObject(button);
-  memcpy(m_button->getType(), (const char*)root[kv.key()]["type"]["resolvedName"], strlen((const char*)root[kv.key()]["type"]["resolvedName"]));
-  memcpy(m_button->getParent(), kv.key().c_str(), strlen(kv.key().c_str()));
-  memcpy(m_button->getEvent(), (const char*)root[kv.key()]["props"]["event"], strlen((const char*)root[kv.key()]["props"]["event"]));
+/* Detach and free the state of a chart when its' object is deleted */
+static void chart_cb(lv_event_t * e) {
+  MGUI_chart_view * view = (MGUI_chart_view*)lv_event_get_user_data(e);
+  if(view->chart->view == view) view->chart->view = NULL;
+  heap_caps_free(view->pixels);
+  free(view->columns);
+  free(view);
+}
 
-  // Store MGUI_object pointer in linked list
-  buttons.add(m_button);
+/* Function for rendering a chart */
+void mgui_render_chart(JsonPair kv, JsonObject root) {
+  MGUI_chart * chart = mgui_chart(kv.key().c_str());
+  MGUI_chart_view * view = (MGUI_chart_view*)calloc(1, sizeof(MGUI_chart_view));
+  if(chart == NULL || view == NULL) {
+    free(view);
+    Serial.println("[MicroGUI]: Out of memory, could not render chart");
+    return;
+  }
 
-  // Store the MGUI object as user data
-  lv_obj_set_user_data(button, m_button);
+  view->chart = chart;
+  view->w = root[kv.key()]["props"]["width"] | 200;
+  view->h = root[kv.key()]["props"]["height"] | 100;
+  view->min = root[kv.key()]["props"]["min"] | 0.0f;
+  view->max = root[kv.key()]["props"]["max"] | 100.0f;
+  view->decimation = root[kv.key()]["props"]["decimation"] | 1;
+  view->color = lv_color_make(root[kv.key()]["props"]["color"]["r"], root[kv.key()]["props"]["color"]["g"], root[kv.key()]["props"]["color"]["b"]);
+  view->background = lv_color_make(root[kv.key()]["props"]["background"]["r"], root[kv.key()]["props"]["background"]["g"], root[kv.key()]["props"]["background"]["b"]);
+  if(view->w < 1) view->w = 1;
+  if(view->h < 1) view->h = 1;
+  if(view->decimation < 1) view->decimation = 1;
+  if(view->max == view->min) view->max = view->min + 1;
+
+  // The plot goes in PSRAM when there is some
+  size_t size = view->w * view->h * sizeof(lv_color_t);
+  view->pixels = (lv_color_t*)heap_caps_malloc(size, MALLOC_CAP_SPIRAM);
+  if(view->pixels == NULL) view->pixels = (lv_color_t*)heap_caps_malloc(size, MALLOC_CAP_8BIT);
+  view->columns = (int16_t*)malloc(view->w * 2 * sizeof(int16_t));
+  if(view->pixels == NULL || view->columns == NULL) {
+    heap_caps_free(view->pixels);
+    free(view->columns);
+    free(view);
+    Serial.println("[MicroGUI]: Out of memory, could not render chart");
+    return;
+  }
+  for(size_t i = 0; i < (size_t)(view->w * view->h); i++) {
+    view->pixels[i] = view->background;
+  }
 
-  // Add event callback
-  lv_obj_add_event_cb(button, widget_cb, LV_EVENT_CLICKED, NULL);   
+  view->img.header.always_zero = 0;
+  view->img.header.cf = LV_IMG_CF_TRUE_COLOR;
+  view->img.header.w = view->w;
+  view->img.header.h = view->h;
+  view->img.data_size = size;
+  view->img.data = (const uint8_t*)view->pixels;
+
+  lv_obj_t * plot = lv_img_create(build_screen);
+  lv_img_set_src(plot, &view->img);
+  lv_obj_set_pos(plot, root[kv.key()]["props"]["pageX"], root[kv.key()]["props"]["pageY"]);
+  lv_obj_add_event_cb(plot, chart_cb, LV_EVENT_DELETE, view);
+  view->obj = plot;
+
+  MGUI_object * m_chart = new MGUI_object;
+  m_chart->setObject(plot);
+  memcpy(m_chart->getType(), (const char*)root[kv.key()]["type"]["resolvedName"], strlen((const char*)root[kv.key()]["type"]["resolvedName"]));
+  memcpy(m_chart->getParent(), kv.key().c_str(), strlen(kv.key().c_str()));
+  m_chart->setData(view);
+
+  charts.add(m_chart);
+  mgui_register_object(m_chart);
+  lv_obj_set_user_data(plot, m_chart);
+
+  // Samples pushed while the chart was not built are dropped, start from now
+  __atomic_store_n(&chart->tail, __atomic_load_n(&chart->head, __ATOMIC_ACQUIRE), __ATOMIC_RELEASE);
+  chart->view = view;
+}
 
-  // Styling
-  lv_obj_set_pos(button, root[kv.key()]["props"]["pageX"], root[kv.key()]["props"]["pageY"]);
-  lv_obj_set_height(button, LV_SIZE_CONTENT);
-  lv_obj_set_style_bg_color(button, lv_color_make(root[kv.key()]["props"]["background"]["r"], root[kv.key()]["props"]["background"]["g"], root[kv.key()]["props"]["background"]["b"]), 0);
-  
-  // Add label to button
-  lv_obj_t * label = lv_label_create(button);
-  const char* text = root[kv.key()]["props"]["text"];
-  lv_label_set_text(label, text);
-  lv_obj_center(label);
-  lv_obj_set_style_text_color(label, lv_color_make(root[kv.key()]["props"]["color"]["r"], root[kv.key()]["props"]["color"]["g"], root[kv.key()]["props"]["color"]["b"]), 0);   
+/* Bindings of application variables to objects, kept by object name across renders */
+typedef struct {
+  char name[100];
+  void * var;
+  MGUI_bind_type type;
+  int32_t shadow;             // Value last shown, the raw bits of a float
+  char * text;                // Text last shown, for text bindings
+  bool synced;                // False until the value has been shown once
+} MGUI_binding;
+
+LinkedList<MGUI_binding*> bindings;
+
+static MGUI_binding * mgui_find_binding(const char * obj_name) {
+  for(int i = 0; i < bindings.size(); i++) {
+    if(mgui_compare(bindings.get(i)->name, obj_name)) return bindings.get(i);
+  }
+  return NULL;
 }
 
-/* Function for rendering a switch */
-void mgui_render_switch(JsonPair kv, JsonObject root) {
-  lv_obj_t * sw = lv_switch_create(lv_scr_act());
-  
-  MGUI_object * m_switch = new MGUI_object;
-  m_switch->setObject(sw);
-  memcpy(m_switch->getType(), (const char*)root[kv.key()]["type"]["resolvedName"], strlen((const char*)root[kv.key()]["type"]["resolvedName"]));
-  memcpy(m_switch->getParent(), kv.key().c_str(), strlen(kv.key().c_str()));
-  memcpy(m_switch->getEvent(), (const char*)root[kv.key()]["props"]["event"], strlen((const char*)root[kv.key()]["props"]["event"]));
+/* Bind a variable to an object. Changes of the variable are shown once per mgui_run(), and sliders, switches and
+   checkboxes write their new value back to it. The variable must outlive the binding */
+bool mgui_bind(const char * obj_name, void * var, MGUI_bind_type type) {
+  MGUI_binding * binding = mgui_find_binding(obj_name);
+  if(binding == NULL) {
+    binding = (MGUI_binding*)calloc(1, sizeof(MGUI_binding));
+    if(binding == NULL) {
+      Serial.println("[MicroGUI]: Out of memory, could not bind variable");
+      return false;
+    }
+    strncpy(binding->name, obj_name, sizeof(binding->name) - 1);
+    bindings.add(binding);
+  }
 
-  switches.add(m_switch);
-  lv_obj_set_user_data(sw, m_switch);
-  lv_obj_add_event_cb(sw, widget_cb, LV_EVENT_VALUE_CHANGED, NULL);
-  
-  if(root[kv.key()]["props"]["state"]) {
-    lv_obj_add_state(sw, LV_STATE_CHECKED);
+  free(binding->text);
+  binding->text = NULL;
+  if(type == MGUI_BIND_TEXT) {
+    binding->text = (char*)calloc(MGUI_BIND_TEXT_SIZE, 1);
+    if(binding->text == NULL) {
+      Serial.println("[MicroGUI]: Out of memory, could not bind variable");
+      mgui_unbind(obj_name);
+      return false;
+    }
   }
 
-  // Styling
-  lv_obj_set_pos(sw, root[kv.key()]["props"]["pageX"], root[kv.key()]["props"]["pageY"]);
-  lv_obj_set_style_bg_color(sw, lv_color_make(188, 188, 188), LV_PART_MAIN | LV_STATE_DEFAULT);
-  lv_obj_set_style_bg_color(sw, lv_color_make(root[kv.key()]["props"]["color"]["r"], root[kv.key()]["props"]["color"]["g"], root[kv.key()]["props"]["color"]["b"]), LV_PART_INDICATOR | LV_STATE_CHECKED);
+  binding->var = var;
+  binding->type = type;
+  binding->synced = false;
+  return true;
+}
 
-  if(mgui_compare((const char*)root[kv.key()]["props"]["size"], "medium")) {
-    lv_obj_set_height(sw, (lv_coord_t)25);
-    lv_obj_set_width(sw, (lv_coord_t)56);
-    lv_obj_set_style_pad_all(sw, (lv_coord_t)4, LV_PART_KNOB);
-  } else {
-    lv_obj_set_height(sw, (lv_coord_t)20);
-    lv_obj_set_width(sw, (lv_coord_t)44);
-    lv_obj_set_style_pad_all(sw, (lv_coord_t)3, LV_PART_KNOB);
+/* Remove the binding of an object */
+void mgui_unbind(const char * obj_name) {
+  for(int i = 0; i < bindings.size(); i++) {
+    if(mgui_compare(bindings.get(i)->name, obj_name)) {
+      free(bindings.get(i)->text);
+      free(bindings.remove(i));
+      return;
+    }
   }
 }
 
-/* Function for rendering a slider */
-void mgui_render_slider(JsonPair kv, JsonObject root) {
-  lv_obj_t * slider = lv_slider_create(lv_scr_act());
+/* Show all bound values again, e.g. in a newly rendered document */
+void mgui_bind_reset() {
+  for(int i = 0; i < bindings.size(); i++) {
+    bindings.get(i)->synced = false;
+  }
+}
 
-  MGUI_object * m_slider = new MGUI_object;
-  m_slider->setObject(slider);
-  memcpy(m_slider->getType(), (const char*)root[kv.key()]["type"]["resolvedName"], strlen((const char*)root[kv.key()]["type"]["resolvedName"]));
-  memcpy(m_slider->getParent(), kv.key().c_str(), strlen(kv.key().c_str()));
-  memcpy(m_slider->getEvent(), (const char*)root[kv.key()]["props"]["event"], strlen((const char*)root[kv.key()]["props"]["event"]));
+/* Read a bound variable for comparing, aligned reads of up to 32 bits are atomic so it may be written by another task */
+static int32_t mgui_bind_read(MGUI_binding * binding) {
+  int32_t raw = 0;
+  switch(binding->type) {
+    case MGUI_BIND_BOOL: raw = *(volatile bool*)binding->var; break;
+    case MGUI_BIND_UINT8: raw = *(volatile uint8_t*)binding->var; break;
+    case MGUI_BIND_INT16: raw = *(volatile int16_t*)binding->var; break;
+    case MGUI_BIND_INT32: raw = *(volatile int32_t*)binding->var; break;
+    case MGUI_BIND_FLOAT: raw = *(volatile int32_t*)binding->var; break;
+    default: break;
+  }
+  return raw;
+}
 
-  sliders.add(m_slider);
-  lv_obj_set_user_data(slider, m_slider);
-  lv_obj_add_event_cb(slider, widget_cb, LV_EVENT_VALUE_CHANGED, NULL);   // LV_EVENT_ALL did not work, hence the two callback setups
-  lv_obj_add_event_cb(slider, widget_cb, LV_EVENT_RELEASED, NULL);
+/* Scale between a float and the integer value of an object, numerics show fixed-point values */
+static float mgui_bind_scale(const char * obj_name) {
+  MGUI_object * object = mgui_find_object(obj_name, &numerics);
+  if(strcmp(object->getType(), "Numeric") != 0) return 1;
 
-  // Styling
-  lv_obj_set_width(slider, root[kv.key()]["props"]["width"]);
-  lv_obj_set_pos(slider, root[kv.key()]["props"]["pageX"], root[kv.key()]["props"]["pageY"]);
-  lv_slider_set_range(slider, root[kv.key()]["props"]["min"], root[kv.key()]["props"]["max"]);
-  lv_slider_set_value(slider, root[kv.key()]["props"]["value"], LV_ANIM_OFF);
-  lv_obj_set_style_bg_color(slider, lv_color_make(root[kv.key()]["props"]["color"]["r"], root[kv.key()]["props"]["color"]["g"], root[kv.key()]["props"]["color"]["b"]), LV_PART_INDICATOR);
-  lv_obj_set_style_bg_color(slider, lv_color_make(root[kv.key()]["props"]["color"]["r"], root[kv.key()]["props"]["color"]["g"], root[kv.key()]["props"]["color"]["b"]), LV_PART_KNOB);
+  float scale = 1;
+  for(uint8_t i = 0; i < ((MGUI_numeric*)object->getData())->decimals; i++) scale *= 10;
+  return scale;
 }
 
-/* Function for rendering a checkbox */
-void mgui_render_checkbox(JsonPair kv, JsonObject root) {
-  lv_obj_t * checkbox = lv_checkbox_create(lv_scr_act());
-
-  MGUI_object * m_checkbox = new MGUI_object;
-  m_checkbox->setObject(checkbox);
-  memcpy(m_checkbox->getType(), (const char*)root[kv.key()]["type"]["resolvedName"], strlen((const char*)root[kv.key()]["type"]["resolvedName"]));
-  memcpy(m_checkbox->getParent(), kv.key().c_str(), strlen(kv.key().c_str()));
-  memcpy(m_checkbox->getEvent(), (const char*)root[kv.key()]["props"]["event"], strlen((const char*)root[kv.key()]["props"]["event"]));
+/* Compare bound variables to the values last shown and update the built objects of the ones that changed */
+void mgui_bind_poll() {
+  for(int i = 0; i < bindings.size(); i++) {
+    MGUI_binding * binding = bindings.get(i);
+
+    // Objects on pages that are not built are left for when their page is built, they show the last value until then
+    if(!mgui_object_built(binding->name)) continue;
+
+    if(binding->type == MGUI_BIND_TEXT) {
+      const char * text = (const char*)binding->var;
+      if(binding->synced && strncmp(text, binding->text, MGUI_BIND_TEXT_SIZE - 1) == 0) continue;
+      strlcpy(binding->text, text, MGUI_BIND_TEXT_SIZE);
+      binding->synced = true;
+      mgui_set_text(binding->name, binding->text);
+      continue;
+    }
 
-  checkboxes.add(m_checkbox);
-  lv_obj_set_user_data(checkbox, m_checkbox);
-  lv_obj_add_event_cb(checkbox, widget_cb, LV_EVENT_VALUE_CHANGED, NULL);
+    int32_t raw = mgui_bind_read(binding);
+    if(binding->synced && raw == binding->shadow) continue;
+    binding->shadow = raw;
+    binding->synced = true;
 
-  if(root[kv.key()]["props"]["state"]) {
-    lv_obj_add_state(checkbox, LV_STATE_CHECKED);
+    if(binding->type == MGUI_BIND_FLOAT) {
+      float value;
+      memcpy(&value, &raw, sizeof(value));
+      mgui_set_value(binding->name, (int)lroundf(value * mgui_bind_scale(binding->name)));
+    }
+    else {
+      mgui_set_value(binding->name, raw);
+    }
   }
+}
 
-  // Styling
-  lv_obj_set_pos(checkbox, root[kv.key()]["props"]["pageX"], root[kv.key()]["props"]["pageY"]);
-  lv_checkbox_set_text(checkbox, "");
-  lv_obj_set_style_border_color(checkbox, lv_color_make(root[kv.key()]["props"]["color"]["r"], root[kv.key()]["props"]["color"]["g"], root[kv.key()]["props"]["color"]["b"]), LV_PART_INDICATOR);
-  lv_obj_set_style_bg_color(checkbox, lv_color_make(255, 255, 255), LV_PART_INDICATOR | LV_STATE_DEFAULT);
-  lv_obj_set_style_bg_color(checkbox, lv_color_make(root[kv.key()]["props"]["color"]["r"], root[kv.key()]["props"]["color"]["g"], root[kv.key()]["props"]["color"]["b"]), LV_PART_INDICATOR | LV_STATE_CHECKED);
-  
-  if(mgui_compare((const char*)root[kv.key()]["props"]["size"], "medium")) {
-    lv_obj_set_style_text_font(checkbox, font_list[2], 0);   // Sets checkbox size
+/* Write a value set on the display or remotely back to the variable bound to an object */
+void mgui_bind_write(const char * obj_name, int value) {
+  MGUI_binding * binding = mgui_find_binding(obj_name);
+  if(binding == NULL) return;
+
+  switch(binding->type) {
+    case MGUI_BIND_BOOL: *(bool*)binding->var = value != 0; break;
+    case MGUI_BIND_UINT8: *(uint8_t*)binding->var = value; break;
+    case MGUI_BIND_INT16: *(int16_t*)binding->var = value; break;
+    case MGUI_BIND_INT32: *(int32_t*)binding->var = value; break;
+    case MGUI_BIND_FLOAT: *(float*)binding->var = value / mgui_bind_scale(obj_name); break;
+    default: return;
   }
-}
 
-/* Function for rendering a textfield */
-void mgui_render_textfield(JsonPair kv, JsonObject root) {
-  lv_obj_t * textfield = lv_label_create(lv_scr_act());
+  // Already shown, do not send it back out
+  binding->shadow = mgui_bind_read(binding);
+}
 
-  MGUI_object * m_textfield = new MGUI_object;
-  m_textfield->setObject(textfield);
-  memcpy(m_textfield->getType(), (const char*)root[kv.key()]["type"]["resolvedName"], strlen((const char*)root[kv.key()]["type"]["resolvedName"]));
-  memcpy(m_textfield->getParent(), kv.key().c_str(), strlen(kv.key().c_str()));
-  memcpy(m_textfield->getEvent(), "NoInput", strlen("NoInput"));
+/* Format a fixed-point value right aligned into width cells without allocating, all cells are '#' if it does not fit */
+static void mgui_numeric_format(char * out, int32_t value, uint8_t width, uint8_t decimals, bool zero_pad) {
+  uint32_t magnitude = value < 0 ? (uint32_t)(-(int64_t)value) : (uint32_t)value;
+  uint8_t digits = 0;
+  int i = width - 1;
+  out[width] = '\0';
+
+  // Write digits from the least significant one, with at least one digit before the decimal point
+  while(i >= 0 && (magnitude > 0 || digits <= decimals)) {
+    if(decimals > 0 && digits == decimals) {
+      out[i--] = '.';
+      if(i < 0) break;
+    }
+    out[i--] = '0' + magnitude % 10;
+    magnitude /= 10;
+    digits++;
+  }
 
-  textfields.add(m_textfield);
-  lv_obj_set_user_data(textfield, m_textfield);
+  if(magnitude > 0 || digits <= decimals || (value < 0 && i < 0)) {
+    memset(out, '#', width);
+    return;
+  }
 
-  // Styling
-  lv_obj_set_pos(textfield, root[kv.key()]["props"]["pageX"], root[kv.key()]["props"]["pageY"]);
-  const char* text = root[kv.key()]["props"]["text"];
-  lv_label_set_text(textfield, text);
-  lv_obj_set_style_text_color(textfield, lv_color_make(root[kv.key()]["props"]["color"]["r"], root[kv.key()]["props"]["color"]["g"], root[kv.key()]["props"]["color"]["b"]), 0);
+  // Sign always goes in the leftmost cell when zero padding, otherwise next to the digits
+  if(zero_pad) {
+    while(i >= 0) out[i--] = '0';
+    if(value < 0) out[0] = '-';
+  } else {
+    if(value < 0) out[i--] = '-';
+    while(i >= 0) out[i--] = ' ';
+  }
+}
 
-  uint8_t fontSize = (uint8_t)root[kv.key()]["props"]["fontSize"];
-  uint8_t i = 0;
- 
-  while(i < sizeof font_sizes && fontSize > font_sizes[i]) {
-    i++;
+/* Show a new value in a Numeric, only the cells that changed are invalidated so only they are redrawn and flushed */
+void mgui_numeric_set(MGUI_object * object, int32_t value) {
+  MGUI_numeric * numeric = (MGUI_numeric*)object->getData();
+  char cells[MGUI_NUMERIC_CELLS + 1];
+  mgui_numeric_format(cells, value, numeric->width, numeric->decimals, numeric->zero_pad);
+  numeric->value = value;
+
+  lv_area_t coords;
+  lv_obj_get_coords(object->getObject(), &coords);
+
+  for(uint8_t i = 0; i < numeric->width; i++) {
+    if(cells[i] == numeric->cells[i]) continue;
+    numeric->cells[i] = cells[i];
+
+    lv_area_t cell;
+    cell.x1 = coords.x1 + i * numeric->cell_w;
+    cell.x2 = cell.x1 + numeric->cell_w - 1;
+    cell.y1 = coords.y1;
+    cell.y2 = coords.y2;
+    lv_obj_invalidate_area(object->getObject(), &cell);
   }
-  lv_obj_set_style_text_font(textfield, font_list[i], 0);   // Sets font size
+}
+
+/* Draws the cells of a Numeric and frees its state when deleted */
+static void numeric_cb(lv_event_t * e) {
+  lv_obj_t * obj = lv_event_get_target(e);
+  MGUI_numeric * numeric = (MGUI_numeric*)lv_event_get_user_data(e);
+
+  if(lv_event_get_code(e) == LV_EVENT_DRAW_MAIN) {
+    lv_draw_ctx_t * draw_ctx = lv_event_get_draw_ctx(e);
+    lv_draw_label_dsc_t label_dsc;
+    lv_draw_label_dsc_init(&label_dsc);
+    lv_obj_init_draw_label_dsc(obj, LV_PART_MAIN, &label_dsc);
+
+    lv_area_t coords;
+    lv_obj_get_coords(obj, &coords);
+
+    // Each glyph is centered in its cell, so the digits never move when their neighbours change
+    lv_point_t pos;
+    pos.y = coords.y1;
+    for(uint8_t i = 0; i < numeric->width; i++) {
+      if(numeric->cells[i] == ' ') continue;
+      pos.x = coords.x1 + i * numeric->cell_w + (numeric->cell_w - lv_font_get_glyph_width(label_dsc.font, numeric->cells[i], 0)) / 2;
+      lv_draw_letter(draw_ctx, &label_dsc, &pos, numeric->cells[i]);
+    }
 
+    if(numeric->unit[0]) {
+      lv_area_t unit_area = coords;
+      unit_area.x1 = coords.x1 + numeric->width * numeric->cell_w;
+      lv_draw_label(draw_ctx, &label_dsc, &unit_area, numeric->unit, NULL);
+    }
+  }
+  else if(lv_event_get_code(e) == LV_EVENT_DELETE) {
+    free(numeric);
+  }
 }
 
-/* Function for rendering a divider */
-void mgui_render_divider(JsonPair kv, JsonObject root) {
-  lv_obj_t * divider = lv_obj_create(lv_scr_act());
+/* Function for rendering a numeric display */
+void mgui_render_numeric(JsonPair kv, JsonObject root) {
+  MGUI_numeric * state = (MGUI_numeric*)calloc(1, sizeof(MGUI_numeric));
+  if(state == NULL) {
+    Serial.println("[MicroGUI]: Out of memory, could not render numeric display");
+    return;
+  }
 
-  MGUI_object * m_divider = new MGUI_object;
-  m_divider->setObject(divider);
-  memcpy(m_divider->getType(), (const char*)root[kv.key()]["type"]["resolvedName"], strlen((const char*)root[kv.key()]["type"]["resolvedName"]));
-  memcpy(m_divider->getParent(), kv.key().c_str(), strlen(kv.key().c_str()));
-  memcpy(m_divider->getEvent(), "NoInput", strlen("NoInput"));
+  lv_obj_t * numeric = lv_obj_create(build_screen);
+
+  MGUI_object * m_numeric = new MGUI_object;
+  m_numeric->setObject(numeric);
+  memcpy(m_numeric->getType(), (const char*)root[kv.key()]["type"]["resolvedName"], strlen((const char*)root[kv.key()]["type"]["resolvedName"]));
+  memcpy(m_numeric->getParent(), kv.key().c_str(), strlen(kv.key().c_str()));
+  memcpy(m_numeric->getEvent(), "NoInput", strlen("NoInput"));
+  m_numeric->setData(state);
+
+  numerics.add(m_numeric);
+  mgui_register_object(m_numeric);
+  lv_obj_set_user_data(numeric, m_numeric);
+  lv_obj_add_event_cb(numeric, numeric_cb, LV_EVENT_ALL, state);
+
+  // Format
+  state->width = constrain((int)(root[kv.key()]["props"]["digits"] | 6), 1, MGUI_NUMERIC_CELLS);
+  state->decimals = constrain((int)root[kv.key()]["props"]["decimals"], 0, state->width - 1);
+  state->zero_pad = mgui_compare(root[kv.key()]["props"]["format"] | "", "zero");
+  strlcpy(state->unit, root[kv.key()]["props"]["unit"] | "", sizeof(state->unit));
+  state->value = (int32_t)root[kv.key()]["props"]["value"];
+  mgui_numeric_format(state->cells, state->value, state->width, state->decimals, state->zero_pad);
+
+  // Styling, no background or padding so that a cell maps directly to the area it is drawn in
+  lv_obj_remove_style_all(numeric);
+  lv_obj_clear_flag(numeric, LV_OBJ_FLAG_CLICKABLE | LV_OBJ_FLAG_SCROLLABLE);
+  lv_obj_add_style(numeric, mgui_style(MGUI_STYLE_TEXT, lv_color_make(root[kv.key()]["props"]["color"]["r"], root[kv.key()]["props"]["color"]["g"], root[kv.key()]["props"]["color"]["b"]), 0), 0);
 
-  dividers.add(m_divider);
-  lv_obj_set_user_data(divider, m_divider);
+  uint8_t fontSize = (uint8_t)root[kv.key()]["props"]["fontSize"];
+  lv_obj_add_style(numeric, mgui_style(MGUI_STYLE_FONT, lv_color_black(), fontSize), 0);
+  const lv_font_t * font = mgui_font(fontSize);
 
-  int height = (int)root[kv.key()]["props"]["thickness"];
-  int width = (int)root[kv.key()]["props"]["length"];
+  const char * glyphs = "0123456789-.#";
+  for(uint8_t i = 0; glyphs[i]; i++) {
+    lv_coord_t w = lv_font_get_glyph_width(font, glyphs[i], 0);
+    if(w > state->cell_w) state->cell_w = w;
+  }
 
-  if(mgui_compare(root[kv.key()]["props"]["orientation"], "vertical")) {
-    int temp = height;
-    height = width;
-    width = temp;
+  lv_point_t unit_size = {0, 0};
+  if(state->unit[0]) {
+    lv_txt_get_size(&unit_size, state->unit, font, 0, 0, LV_COORD_MAX, LV_TEXT_FLAG_NONE);
   }
 
-  lv_obj_set_size(divider, width, height);
-  lv_obj_align(divider, LV_ALIGN_TOP_LEFT, (lv_coord_t)root[kv.key()]["props"]["pageX"], (lv_coord_t)root[kv.key()]["props"]["pageY"]);
-  lv_obj_set_style_bg_color(divider, lv_color_make(root[kv.key()]["props"]["color"]["r"], root[kv.key()]["props"]["color"]["g"], root[kv.key()]["props"]["color"]["b"]), 0);
-  lv_obj_set_style_border_width(divider, 0, 0);
-  lv_obj_set_style_border_width(divider, 0, 0);
-  lv_obj_set_style_radius(divider, 0, 0);
-  lv_obj_set_scrollbar_mode(divider, LV_SCROLLBAR_MODE_OFF);
+  lv_obj_set_pos(numeric, root[kv.key()]["props"]["pageX"], root[kv.key()]["props"]["pageY"]);
+  lv_obj_set_size(numeric, state->width * state->cell_w + unit_size.x, lv_font_get_line_height(font));
 }
 
 // Initial attempt for rendering the divider element. This is not a suitable solution at the moment because of a 
@@ -821,12 +3354,118 @@ void mgui_render_border() {
   lv_style_set_line_rounded(&style_line, true);
 
   /*Create a line and apply the new style*/
-  border = lv_line_create(lv_scr_act());
+  border = lv_line_create(lv_layer_top());     // Above every page
   lv_line_set_points(border, line_points, 5);     /*Set the points*/
   lv_obj_add_style(border, &style_line, 0);
   lv_obj_center(border);
 }
 
+/* Draw static objects into the static layer and hide them, so that redraws blit the layer instead of drawing each of them */
+void mgui_cache_static() {
+#if MGUI_STATIC_CACHE
+  lv_obj_t * screen = lv_scr_act();
+
+  // Show everything that was drawn into the previous layer again, which may be on another page
+  if(static_layer != NULL) {
+    lv_obj_t * old_screen = lv_obj_get_parent(static_layer);
+    lv_obj_del(static_layer);
+    static_layer = NULL;
+    for(uint32_t i = 0; i < lv_obj_get_child_cnt(old_screen); i++) {
+      lv_obj_t * child = lv_obj_get_child(old_screen, i);
+      if(lv_obj_has_flag(child, MGUI_FLAG_STATIC)) lv_obj_clear_flag(child, LV_OBJ_FLAG_HIDDEN);
+    }
+  }
+  uint32_t count = lv_obj_get_child_cnt(screen);
+  lv_obj_update_layout(screen);
+
+  // A static object can only be moved into the background if no live object below it overlaps it
+  bool * flat = (bool*)calloc(count, sizeof(bool));
+  if(flat == NULL) return;
+  uint16_t costly = 0;     // Text and images, which take longer to draw than to copy
+  for(uint32_t i = 0; i < count; i++) {
+    lv_obj_t * child = lv_obj_get_child(screen, i);
+    if(!lv_obj_has_flag(child, MGUI_FLAG_STATIC)) continue;
+
+    lv_area_t area, below, common;
+    lv_obj_get_coords(child, &area);
+    flat[i] = true;
+    for(uint32_t j = 0; j < i && flat[i]; j++) {
+      if(flat[j]) continue;
+      lv_obj_get_coords(lv_obj_get_child(screen, j), &below);
+      if(_lv_area_intersect(&common, &area, &below)) flat[i] = false;
+    }
+    if(flat[i] && (lv_obj_check_type(child, &lv_label_class) || lv_obj_check_type(child, &lv_img_class))) costly++;
+  }
+
+  // Rectangles are filled about as fast as the layer is copied, it only pays off when it holds something else
+  if(costly == 0) {
+    free(flat);
+    return;
+  }
+
+  uint32_t size = lv_snapshot_buf_size_needed(screen, LV_IMG_CF_TRUE_COLOR);
+  if(static_buf_size < size) {
+    heap_caps_free(static_buf);
+    static_buf_size = 0;
+    static_buf = (uint8_t*)heap_caps_malloc(size, MALLOC_CAP_SPIRAM);
+    // Without PSRAM, only use internal RAM if plenty is left for WiFi and LVGL
+    if(static_buf == NULL && heap_caps_get_largest_free_block(MALLOC_CAP_8BIT) > size + 65536) {
+      static_buf = (uint8_t*)heap_caps_malloc(size, MALLOC_CAP_8BIT);
+    }
+    if(static_buf == NULL) {
+      Serial.println("[MicroGUI]: Not enough memory for the static layer, static objects are drawn as usual");
+      free(flat);
+      return;
+    }
+    static_buf_size = size;
+  }
+
+  // Snapshot the screen with only the static objects visible
+  for(uint32_t i = 0; i < count; i++) {
+    lv_obj_t * child = lv_obj_get_child(screen, i);
+    if(!flat[i] && !lv_obj_has_flag(child, LV_OBJ_FLAG_HIDDEN)) {
+      lv_obj_add_flag(child, LV_OBJ_FLAG_HIDDEN | LV_OBJ_FLAG_USER_2);    // USER_2 marks what to show again
+    }
+  }
+
+  lv_res_t res = lv_snapshot_take_to_buf(screen, LV_IMG_CF_TRUE_COLOR, &static_dsc, static_buf, static_buf_size);
+
+  for(uint32_t i = 0; i < count; i++) {
+    lv_obj_t * child = lv_obj_get_child(screen, i);
+    if(lv_obj_has_flag(child, LV_OBJ_FLAG_USER_2)) {
+      lv_obj_clear_flag(child, LV_OBJ_FLAG_HIDDEN | LV_OBJ_FLAG_USER_2);
+    }
+    else if(flat[i] && res == LV_RES_OK) {
+      lv_obj_add_flag(child, LV_OBJ_FLAG_HIDDEN);
+    }
+  }
+  free(flat);
+
+  if(res != LV_RES_OK) {
+    Serial.println("[MicroGUI]: Could not draw the static layer, static objects are drawn as usual");
+    return;
+  }
+
+  lv_img_cache_invalidate_src(&static_dsc);
+  static_layer = lv_img_create(screen);
+  lv_img_set_src(static_layer, &static_dsc);
+  lv_obj_set_pos(static_layer, 0, 0);
+  lv_obj_move_background(static_layer);
+#endif
+}
+
+/* An object that is about to change can no longer be part of the static layer */
+void mgui_make_dynamic(lv_obj_t * obj) {
+  if(!lv_obj_has_flag(obj, MGUI_FLAG_STATIC)) return;
+  lv_obj_clear_flag(obj, MGUI_FLAG_STATIC);
+
+  // Its old look is drawn into the layer, which has to be redrawn without it
+  if(lv_obj_has_flag(obj, LV_OBJ_FLAG_HIDDEN)) {
+    lv_obj_clear_flag(obj, LV_OBJ_FLAG_HIDDEN);
+    mgui_cache_static();
+  }
+}
+
 /* Show border */
 void mgui_show_border() {
   if(!border_vis) {
@@ -851,18 +3490,145 @@ void display_flush(lv_disp_drv_t * disp, const lv_area_t *area, lv_color_t *colo
   uint32_t w = (area->x2 - area->x1 + 1);
   uint32_t h = (area->y2 - area->y1 + 1);
 
-  lcd.startWrite();
-  lcd.setAddrWindow(area->x1, area->y1, w, h);
-  lcd.pushPixels((uint16_t *)&color_p->full, w * h, true);
-  lcd.endWrite();
+  // Give up the bus between chunks, a waiting touch read has a higher priority and gets it right away
+  uint32_t rows = MGUI_FLUSH_CHUNK / w > 0 ? MGUI_FLUSH_CHUNK / w : 1;
+  for(uint32_t y = 0; y < h; y += rows) {
+    uint32_t n = h - y < rows ? h - y : rows;
+
+    xSemaphoreTake(lcd_mutex, portMAX_DELAY);
+    uint32_t start = micros();
+    lcd.startWrite();
+    lcd.setAddrWindow(area->x1, area->y1 + y, w, n);
+    #if MGUI_FLUSH_DMA
+    lcd.pushPixelsDMA((uint16_t *)&color_p[y * w].full, w * n, true);
+    lcd.waitDMA();
+    #else
+    lcd.pushPixels((uint16_t *)&color_p[y * w].full, w * n, true);
+    #endif
+    lcd.endWrite();
+    stats.flush_bus_us += micros() - start;
+    xSemaphoreGive(lcd_mutex);
+  }
+  stats.flushes++;
+  stats.flush_px += w * h;
+
+  mgui_mirror_flush(area, color_p);
 
   lv_disp_flush_ready(disp);
 }
 
-/* Touchpad callback to read the touchpad */
-void touchpad_read(lv_indev_drv_t * indev_driver, lv_indev_data_t * data) {
+/* Display callback after every refresh, with the time it took and the number of pixels redrawn */
+void display_monitor(lv_disp_drv_t * disp, uint32_t time, uint32_t px) {
+  stats.frames++;
+  stats.last_frame_ms = time;
+  if(time > stats.max_frame_ms) stats.max_frame_ms = time;
+  stats.frame_ms += time;
+  stats.frame_px += px;
+}
+
+/* Read the touch controller */
+static bool mgui_touch_sample(uint16_t * x, uint16_t * y) {
+  uint32_t start = micros();
+  xSemaphoreTake(lcd_mutex, portMAX_DELAY);
+  uint32_t taken = micros();
+  bool touched = lcd.getTouch(x, y);
+  uint32_t done = micros();
+  xSemaphoreGive(lcd_mutex);
+
+  if(taken - start > stats.touch_wait_max_us) stats.touch_wait_max_us = taken - start;
+  stats.touch_bus_us += done - taken;
+  stats.touch_reads++;
+  return touched;
+}
+
+#if MGUI_TOUCH_TASK
+static TaskHandle_t touch_task = NULL;
+static uint32_t touch_slot = 0;       // Latest filtered touch, pressed in bit 31, x in bits 16-30 and y in bits 0-15
+
+static void IRAM_ATTR touch_isr() {
+  BaseType_t woken = pdFALSE;
+  vTaskNotifyGiveFromISR(touch_task, &woken);
+  if(woken) portYIELD_FROM_ISR();
+}
+
+static int32_t mgui_median3(int32_t a, int32_t b, int32_t c) {
+  if(a > b) { int32_t t = a; a = b; b = t; }
+  if(b > c) b = c;
+  return a > b ? a : b;
+}
+
+/* Sleeps until touched, then samples until released. Samples go through a median of three against spikes
+   and an IIR filter against jitter, both started from the first sample so that presses land where touched */
+static void mgui_touch_task(void * param) {
+  bool irq = param != NULL;
+
+  while(true) {
+    ulTaskNotifyTake(pdTRUE, irq ? portMAX_DELAY : pdMS_TO_TICKS(MGUI_TOUCH_IDLE_PERIOD));
+
+    uint16_t x, y;
+    if(!mgui_touch_sample(&x, &y)) continue;
+
+    int32_t hist_x[3] = {x, x, x};
+    int32_t hist_y[3] = {y, y, y};
+    int32_t filt_x = x * 16;          // In 1/16 pixels
+    int32_t filt_y = y * 16;
+    uint8_t n = 0;
+    uint32_t slot;
+
+    do {
+      hist_x[n] = x;
+      hist_y[n] = y;
+      n = (n + 1) % 3;
+      filt_x += (mgui_median3(hist_x[0], hist_x[1], hist_x[2]) * 16 - filt_x) * MGUI_TOUCH_FILTER / 16;
+      filt_y += (mgui_median3(hist_y[0], hist_y[1], hist_y[2]) * 16 - filt_y) * MGUI_TOUCH_FILTER / 16;
+
+      slot = 0x80000000 | ((uint32_t)(filt_x / 16) & 0x7fff) << 16 | ((uint32_t)(filt_y / 16) & 0xffff);
+      __atomic_store_n(&touch_slot, slot, __ATOMIC_RELEASE);
+      vTaskDelay(pdMS_TO_TICKS(MGUI_TOUCH_PERIOD));
+    } while(mgui_touch_sample(&x, &y));
+
+    // Released where last touched
+    __atomic_store_n(&touch_slot, slot & 0x7fffffff, __ATOMIC_RELEASE);
+    ulTaskNotifyTake(pdTRUE, 0);      // Interrupts raised while sampling
+  }
+}
+#endif
+
+/* Start the touch task, the touchpad is polled from LVGL if it can not be started */
+void mgui_touch_init(lv_indev_drv_t * indev_drv) {
+  #if MGUI_TOUCH_TASK
+  if(touch_task != NULL || lcd.touch() == NULL) return;
+
+  int16_t pin = MGUI_TOUCH_PIN >= 0 ? MGUI_TOUCH_PIN : lcd.touch()->config().pin_int;
+  if(xTaskCreatePinnedToCore(mgui_touch_task, "mgui_touch", 3072, pin >= 0 ? (void*)1 : NULL, 2, &touch_task, xPortGetCoreID()) != pdPASS) {
+    touch_task = NULL;
+    Serial.println("[MicroGUI]: Could not start the touch task, polling the touchpad");
+    return;
+  }
+  if(pin >= 0) {
+    pinMode(pin, INPUT_PULLUP);
+    attachInterrupt(digitalPinToInterrupt(pin), touch_isr, FALLING);
+  }
+
+  // Reading the slot does not touch the bus, so LVGL can take it as often as it is sampled
+  lv_timer_set_period(indev_drv->read_timer, MGUI_TOUCH_PERIOD);
+  #endif
+}
+
+/* Latest touch from the touch task, or read from the touchpad */
+static void mgui_touch_point(lv_indev_data_t * data) {
+  #if MGUI_TOUCH_TASK
+  if(touch_task != NULL) {
+    uint32_t slot = __atomic_load_n(&touch_slot, __ATOMIC_ACQUIRE);
+    data->state = slot & 0x80000000 ? LV_INDEV_STATE_PR : LV_INDEV_STATE_REL;
+    data->point.x = (slot >> 16) & 0x7fff;
+    data->point.y = slot & 0xffff;
+    return;
+  }
+  #endif
+
   uint16_t touchX, touchY;
-  bool touched = lcd.getTouch(&touchX, &touchY);
+  bool touched = mgui_touch_sample(&touchX, &touchY);
 
   if (!touched){
     data->state = LV_INDEV_STATE_REL;
@@ -874,4 +3640,107 @@ void touchpad_read(lv_indev_drv_t * indev_driver, lv_indev_data_t * data) {
     data->point.x = touchX;
     data->point.y = touchY;
   }
+}
+
+/** Power */
+
+static MGUI_power power = MGUI_POWER_IDLE;      // The first mgui_run() makes it active and sets the refresh rates
+static uint32_t dim_timeout = MGUI_DIM_TIMEOUT;
+static uint32_t sleep_timeout = MGUI_SLEEP_TIMEOUT;
+static volatile uint32_t last_touch = 0;
+static volatile uint32_t last_remote = 0;
+static uint8_t brightness = 0;        // Backlight before dimming
+static bool touch_swallow = false;    // The touch that woke the display is not passed on
+
+/* Touchpad callback to read the touchpad */
+void touchpad_read(lv_indev_drv_t * indev_driver, lv_indev_data_t * data) {
+  mgui_touch_point(data);
+  mgui_trace_touch(data);
+  if(data->state != LV_INDEV_STATE_PR) {
+    touch_swallow = false;
+    return;
+  }
+
+  last_touch = millis();
+  if(power == MGUI_POWER_SLEEP) touch_swallow = true;
+  if(touch_swallow) data->state = LV_INDEV_STATE_REL;
+}
+
+/* Dim the backlight after dim_ms and put the panel to sleep after sleep_ms without touch, 0 for never */
+void mgui_set_idle(uint32_t dim_ms, uint32_t sleep_ms) {
+  dim_timeout = dim_ms;
+  sleep_timeout = sleep_ms;
+}
+
+/* Count as a touch, e.g. to show an alarm on a sleeping display */
+void mgui_wake() {
+  last_touch = millis();
+}
+
+/* Remote clients keep the refresh rate up, but do not wake a dimmed or sleeping display */
+void mgui_remote_activity() {
+  last_remote = millis();
+}
+
+MGUI_power mgui_get_power() {
+  return power;
+}
+
+static void mgui_set_power(MGUI_power target) {
+  if(target == power) return;
+
+  // Changes made while asleep are held back by the paused refresh and drawn on wake
+  if(power == MGUI_POWER_SLEEP) {
+    xSemaphoreTake(lcd_mutex, portMAX_DELAY);
+    lcd.wakeup();
+    xSemaphoreGive(lcd_mutex);
+    lv_timer_resume(disp->refr_timer);
+  }
+  if(power <= MGUI_POWER_IDLE && target >= MGUI_POWER_DIM) {
+    brightness = lcd.getBrightness();
+  }
+
+  xSemaphoreTake(lcd_mutex, portMAX_DELAY);
+  if(target == MGUI_POWER_SLEEP) {
+    lcd.setBrightness(0);
+    lcd.sleep();
+  }
+  else if(target == MGUI_POWER_DIM) {
+    lcd.setBrightness(brightness < MGUI_DIM_BRIGHTNESS ? brightness : MGUI_DIM_BRIGHTNESS);
+  }
+  else if(power >= MGUI_POWER_DIM) {
+    lcd.setBrightness(brightness);
+  }
+  xSemaphoreGive(lcd_mutex);
+
+  if(target == MGUI_POWER_SLEEP) {
+    lv_timer_pause(disp->refr_timer);
+  }
+
+  // Touch is read as often as it is sampled during interaction, and as often as the display is refreshed otherwise
+  uint32_t period = target == MGUI_POWER_ACTIVE ? MGUI_REFR_ACTIVE : MGUI_REFR_IDLE;
+  lv_timer_set_period(disp->refr_timer, period);
+  if(target == MGUI_POWER_ACTIVE) {
+    period = LV_INDEV_DEF_READ_PERIOD;
+    #if MGUI_TOUCH_TASK
+    if(touch_task != NULL) period = MGUI_TOUCH_PERIOD;
+    #endif
+  }
+  lv_timer_set_period(touch_drv->read_timer, period);
+
+  power = target;
+}
+
+/* Pick the power state from the time since the latest touch and remote activity */
+void mgui_govern() {
+  if(disp == NULL) return;
+
+  uint32_t now = millis();
+  uint32_t touch_idle = now - last_touch;
+  uint32_t remote_idle = now - last_remote;
+
+  if(sleep_timeout && touch_idle >= sleep_timeout) mgui_set_power(MGUI_POWER_SLEEP);
+  else if(dim_timeout && touch_idle >= dim_timeout) mgui_set_power(MGUI_POWER_DIM);
+  else if(touch_idle < MGUI_IDLE_AFTER || remote_idle < MGUI_IDLE_AFTER) mgui_set_power(MGUI_POWER_ACTIVE);
+  else mgui_set_power(MGUI_POWER_IDLE);
 }
\ No newline at end of file
@@ -22,6 +22,9 @@ class MGUI_object {
     char parent_id[100]={0};
     char event_id[100]={0};
     char type[30]={0};
+    uint16_t index = 0;       // Position in the object registry
+    uint32_t version = 0;     // State version of the latest change to this object
+    void * data = NULL;       // Widget specific state, owned by the widget
     
   public:
     MGUI_object(lv_obj_t * obj, const char * obj_type, const char * obj_name, const char * obj_event);
@@ -31,6 +34,12 @@ class MGUI_object {
     char* getEvent();
     char* getParent();
     char* getType();
+    uint16_t getIndex();
+    void setIndex(uint16_t idx);
+    uint32_t getVersion();
+    void setVersion(uint32_t ver);
+    void * getData();
+    void setData(void * ptr);
 };
 
 /* MicroGUI event class */
@@ -55,13 +64,298 @@ typedef enum {
   MGUI_LANDSCAPE_FLIPPED  
 }MGUI_orientation;
 
+/* Number of state changes remembered for delta sync, may be overridden with a build flag */
+#ifndef MGUI_JOURNAL_SIZE
+#define MGUI_JOURNAL_SIZE 64
+#endif
+
+/* Milliseconds without new patches before a patched document is stored in flash */
+#ifndef MGUI_STORE_DELAY
+#define MGUI_STORE_DELAY 5000
+#endif
+
+/* Font files, used instead of the built-in fonts when MGUI_FONT_FILES is defined */
+#ifndef MGUI_FONT_DIR
+#define MGUI_FONT_DIR "S:/littlefs/fonts"     // Holds one LVGL binary font per size, e.g. 24.bin
+#endif
+#ifndef MGUI_GLYPH_CACHE_SIZE
+#define MGUI_GLYPH_CACHE_SIZE 16384           // Bytes of glyph bitmaps kept in RAM
+#endif
+#ifndef MGUI_GLYPH_CACHE_ENTRIES
+#define MGUI_GLYPH_CACHE_ENTRIES 128
+#endif
+
+/* Bytes of decoded images kept in RAM, PSRAM when available. Larger images are decoded row by row when drawn */
+#ifndef MGUI_IMAGE_CACHE_SIZE
+#define MGUI_IMAGE_CACHE_SIZE 65536
+#endif
+
+/* Bytes of touch and WebSocket input kept by mgui_record_start(), in PSRAM when available */
+#ifndef MGUI_TRACE_SIZE
+#define MGUI_TRACE_SIZE 65536
+#endif
+
+/* Rows kept by a Table filled with mgui_table_add_row(), the oldest row is dropped when full */
+#ifndef MGUI_TABLE_RING_SIZE
+#define MGUI_TABLE_RING_SIZE 100
+#endif
+
+/* Samples buffered per Chart between two calls to mgui_run(), must be a power of two */
+#ifndef MGUI_CHART_RING_SIZE
+#define MGUI_CHART_RING_SIZE 1024
+#endif
+
+/* Longest text compared by a text binding, see mgui_bind() */
+#ifndef MGUI_BIND_TEXT_SIZE
+#define MGUI_BIND_TEXT_SIZE 64
+#endif
+
+/* Event handlers, see mgui_on() */
+#ifndef MGUI_EVENT_QUEUE
+#define MGUI_EVENT_QUEUE 8            // Events kept between two calls to mgui_run()
+#endif
+#ifndef MGUI_HANDLER_BUCKETS
+#define MGUI_HANDLER_BUCKETS 32
+#endif
+#ifndef MGUI_WORKER_STACK
+#define MGUI_WORKER_STACK 4096        // Stack of the task running handlers registered with worker set
+#endif
+
+/* Touch, sampled by a task woken by the touch controller's interrupt line. Set MGUI_TOUCH_TASK to 0 to poll from LVGL */
+#ifndef MGUI_TOUCH_TASK
+#define MGUI_TOUCH_TASK 1
+#endif
+#ifndef MGUI_TOUCH_PIN
+#define MGUI_TOUCH_PIN -1             // Interrupt pin, -1 to take it from the LovyanGFX touch config
+#endif
+#ifndef MGUI_TOUCH_PERIOD
+#define MGUI_TOUCH_PERIOD 10          // Milliseconds between samples while touched
+#endif
+#ifndef MGUI_TOUCH_IDLE_PERIOD
+#define MGUI_TOUCH_IDLE_PERIOD 30     // Milliseconds between samples while not touched, without an interrupt pin
+#endif
+#ifndef MGUI_TOUCH_FILTER
+#define MGUI_TOUCH_FILTER 8           // Weight of a new sample out of 16, 16 turns smoothing off
+#endif
+
+/* Display flushes are split into chunks of this many pixels, touch reads get the bus between chunks */
+#ifndef MGUI_FLUSH_CHUNK
+#define MGUI_FLUSH_CHUNK 1024
+#endif
+#ifndef MGUI_FLUSH_DMA
+#define MGUI_FLUSH_DMA 1
+#endif
+
+/* Refresh governor, the display is refreshed less often when nobody interacts with it */
+#ifndef MGUI_REFR_ACTIVE
+#define MGUI_REFR_ACTIVE 20           // Refresh period in milliseconds during interaction
+#endif
+#ifndef MGUI_REFR_IDLE
+#define MGUI_REFR_IDLE 100            // Refresh and touch read period in milliseconds when idle
+#endif
+#ifndef MGUI_IDLE_AFTER
+#define MGUI_IDLE_AFTER 3000          // Milliseconds without touch or remote activity before the display is idle
+#endif
+#ifndef MGUI_DIM_TIMEOUT
+#define MGUI_DIM_TIMEOUT 0            // Milliseconds without touch before dimming the backlight, 0 for never
+#endif
+#ifndef MGUI_SLEEP_TIMEOUT
+#define MGUI_SLEEP_TIMEOUT 0          // Milliseconds without touch before putting the panel to sleep, 0 for never
+#endif
+#ifndef MGUI_DIM_BRIGHTNESS
+#define MGUI_DIM_BRIGHTNESS 32
+#endif
+
+/* The GUI document is kept in a buffer sized to it, with room to grow by MGUI_DOC_SLACK bytes before it is moved */
+#ifndef MGUI_DOC_SLACK
+#define MGUI_DOC_SLACK 512
+#endif
+#ifndef MGUI_DOC_PSRAM
+#define MGUI_DOC_PSRAM 1              // Keep the document in PSRAM when there is some
+#endif
+#ifndef MGUI_JSON_FACTOR
+#define MGUI_JSON_FACTOR 3            // Bytes of parsed JSON tree per byte of document
+#endif
+
+/* Start WiFi and the web server from a task of its own, so that mgui_remote_init() returns at once */
+#ifndef MGUI_REMOTE_DEFER
+#define MGUI_REMOTE_DEFER 1
+#endif
+
+/* Run the captive portal DNS, WiFi reconnection and WebSocket housekeeping on a task on the other core,
+   instead of from mgui_run(). The task starts WiFi in the background, like MGUI_REMOTE_DEFER */
+#ifndef MGUI_NET_TASK
+#define MGUI_NET_TASK 1
+#endif
+#ifndef MGUI_NET_PERIOD
+#define MGUI_NET_PERIOD 10            // Milliseconds between DNS polls
+#endif
+#ifndef MGUI_RECONNECT_MAX
+#define MGUI_RECONNECT_MAX 30000      // Longest wait in milliseconds between WiFi reconnection attempts
+#endif
+#ifndef MGUI_MIRROR_FPS
+#define MGUI_MIRROR_FPS 10            // Most frames a second sent to clients mirroring the display
+#endif
+#if MGUI_MIRROR_FPS < 1
+#error "MGUI_MIRROR_FPS must be at least 1"
+#endif
+#ifndef MGUI_MIRROR_CLIENTS
+#define MGUI_MIRROR_CLIENTS 4
+#endif
+#ifndef MGUI_MIRROR_BUFFER
+#define MGUI_MIRROR_BUFFER 8192       // Largest mirroring message in bytes, must hold a row of the display
+#endif
+#ifndef MGUI_REST_MAX_BODY
+#define MGUI_REST_MAX_BODY 4096       // Largest batch accepted by POST /api/widgets, in bytes
+#endif
+#ifndef MGUI_REST_MAX_TEXT
+#define MGUI_REST_MAX_TEXT 256        // Longest text accepted by POST /api/widgets, in bytes
+#endif
+
+/* Draw the canvas, dividers and textfields that are never written once into a background image, set to 0 to disable */
+#ifndef MGUI_STATIC_CACHE
+#define MGUI_STATIC_CACHE 1
+#endif
+
+/* Pages, only the shown page and up to MGUI_PAGE_CACHE - 1 recently shown pages are kept built */
+#ifndef MGUI_PAGE_CACHE
+#define MGUI_PAGE_CACHE 3
+#endif
+#ifndef MGUI_PAGE_MIN_FREE
+#define MGUI_PAGE_MIN_FREE 8192       // Pages are torn down while LVGL has fewer free bytes than this
+#endif
+#ifndef MGUI_PAGE_PREBUILD
+#define MGUI_PAGE_PREBUILD 0          // Set to 1 to build the pages next to the shown one in advance
+#endif
+#ifndef MGUI_MAX_PAGES
+#define MGUI_MAX_PAGES 32             // Documents with a page prop of this or more are not rendered
+#endif
+#if MGUI_MAX_PAGES > 255
+#error "MGUI_MAX_PAGES must be at most 255"
+#endif
+
+/* Memory use, see mgui_mem_report() */
+typedef struct {
+  uint32_t lvgl_total;            // LVGL's own heap, LV_MEM_SIZE
+  uint32_t lvgl_free;
+  uint32_t lvgl_biggest_free;
+  uint32_t lvgl_max_used;         // Most ever used
+  uint8_t lvgl_used_pct;
+  uint8_t lvgl_frag_pct;
+  uint32_t render_used;           // LVGL heap used after the latest render or page build
+  uint32_t render_max_used;       // Highest render_used, keeps growing if re-renders leak
+  uint32_t renders;
+  uint32_t heap_total;            // Internal RAM
+  uint32_t heap_free;
+  uint32_t heap_min_free;
+  uint32_t heap_biggest_free;
+  uint32_t psram_total;           // 0 without PSRAM
+  uint32_t psram_free;
+  uint32_t psram_biggest_free;
+  uint32_t lvgl_objects;          // LVGL objects on all built pages, including the ones inside widgets
+  uint16_t textfields;
+  uint16_t buttons;
+  uint16_t switches;
+  uint16_t sliders;
+  uint16_t checkboxes;
+  uint16_t dividers;
+  uint16_t numerics;
+  uint16_t images;
+  uint16_t tables;
+  uint16_t charts;
+} MGUI_mem;
+
+/* Time taken by each phase of booting the GUI, see mgui_get_boot() */
+typedef struct {
+  uint32_t nvs_ms;                // Reading a GUI stored in flash
+  uint32_t parse_ms;
+  uint32_t lcd_ms;                // Display init, including board autodetection
+  uint32_t lvgl_ms;
+  uint32_t render_ms;
+  uint32_t first_frame_ms;        // Since power on, when the first frame was on the display
+  uint32_t remote_ms;             // Since power on, when the web server was up, 0 until then
+  bool board_cached;              // Board autodetection was skipped
+} MGUI_boot;
+
+/* What happened during a replay, see mgui_replay_report() */
+typedef struct {
+  bool running;
+  uint32_t duration_ms;
+  uint32_t touches;               // Touch samples and WebSocket messages replayed
+  uint32_t messages;
+  uint32_t frames;
+  uint32_t frame_ms;              // Time taken by all refreshes, divide by frames for the average
+  uint32_t max_frame_ms;
+  uint32_t flush_bus_us;
+  uint32_t touch_wait_max_us;
+  uint32_t events_dropped;
+} MGUI_replay;
+
+/* Statistics about the GUI, see mgui_get_stats() */
+typedef struct {
+  uint8_t page_count;
+  uint8_t pages_built;
+  uint32_t page_switches;
+  uint32_t page_builds;
+  uint32_t page_evictions;
+  uint32_t last_switch_ms;      // Time taken by the latest page switch, including building the page
+  uint32_t max_switch_ms;
+  uint32_t last_build_ms;
+  uint32_t frames;              // Display refreshes
+  uint32_t last_frame_ms;       // Time taken by the latest refresh, drawing and flushing
+  uint32_t max_frame_ms;
+  uint32_t frame_ms;            // Time taken by all refreshes, divide by frames for the average
+  uint32_t frame_px;            // Pixels redrawn by all refreshes
+  uint32_t flushes;
+  uint32_t flush_px;
+  uint32_t flush_bus_us;        // Time the display has held the bus, divide by the time passed for its' occupancy
+  uint32_t touch_reads;
+  uint32_t touch_bus_us;
+  uint32_t touch_wait_max_us;   // Longest time a touch read waited for the display to free the bus
+  uint32_t events;              // Events queued for mgui_on() handlers
+  uint32_t events_dropped;      // Events lost to a full event queue or a busy worker
+  uint16_t event_queue_depth;   // Events waiting for mgui_run()
+} MGUI_stats;
+
 /* Variables used in MicroGUI Core and extensions */
 
 extern MGUI_event * latest;
 extern bool new_event;
-extern char document[];
+extern char * document;
 extern bool from_persistant;
 
+/* Functions used in MicroGUI Core and extensions */
+
+typedef void (*MGUI_object_cb)(MGUI_object * object, void * arg);
+typedef void (*MGUI_slot_cb)(uint16_t index, void * arg);
+
+uint32_t mgui_state_version();
+uint32_t mgui_state_epoch();
+bool mgui_state_message(MGUI_object * object, char * buf, size_t len);
+bool mgui_for_each_change(uint32_t since, MGUI_slot_cb cb, void * arg);
+void mgui_for_each_object(MGUI_object_cb cb, void * arg);
+void mgui_for_each_slot(MGUI_slot_cb cb, void * arg);
+bool mgui_slot_message(uint16_t index, char * buf, size_t len);
+size_t mgui_slot_message_size(uint16_t index);
+uint16_t mgui_object_count();
+MGUI_object * mgui_object_at(uint16_t index);
+size_t mgui_widget_json(MGUI_object * object, char * buf, size_t len);
+uint32_t mgui_document_hash();
+size_t mgui_json_capacity(size_t len);
+bool mgui_patch_document(const char * patch);
+const lv_font_t * mgui_font_file(uint8_t size);
+void mgui_image_init();
+const void * mgui_image_src(const char * name);
+void mgui_bind_write(const char * obj_name, int value);
+void mgui_queue_event(const MGUI_event * event);
+void mgui_remote_activity();
+void mgui_boot_remote_ready();
+void mgui_stats_reset_max();
+const MGUI_stats * mgui_stats_counters();
+uint16_t mgui_event_queue_depth();
+void mgui_trace_touch(lv_indev_data_t * data);
+void mgui_trace_message(const uint8_t * data, size_t len);
+
 /* MicroGUI functions */
 
 void mgui_init();
@@ -89,4 +383,68 @@ void mgui_set_text(const char * obj_name, const char * text);
 
 int mgui_get_value(const char * obj_name);
 
+bool mgui_image_register(const char * name, const uint8_t * data, uint32_t size);
+
+/* Returns the text of a Table cell, it may be written into buf */
+typedef const char * (*MGUI_table_cb)(uint32_t row, uint8_t column, char * buf, size_t len);
+
+void mgui_table_set_source(const char * obj_name, MGUI_table_cb cb, uint32_t rows);
+void mgui_table_set_rows(const char * obj_name, uint32_t rows);
+void mgui_table_add_row(const char * obj_name, const char * cells);
+void mgui_table_refresh(const char * obj_name);
+
+/* Handle of a Chart, samples can be pushed to it from another task than the one calling mgui_run() */
+typedef struct MGUI_chart MGUI_chart;
+
+MGUI_chart * mgui_chart(const char * obj_name);
+uint32_t mgui_chart_push(MGUI_chart * chart, const float * samples, uint32_t n);
+
+/* Types of application variables that can be bound to objects */
+typedef enum {
+  MGUI_BIND_BOOL,
+  MGUI_BIND_UINT8,
+  MGUI_BIND_INT16,
+  MGUI_BIND_INT32,
+  MGUI_BIND_FLOAT,
+  MGUI_BIND_TEXT              // char array, shown in a textfield
+} MGUI_bind_type;
+
+bool mgui_bind(const char * obj_name, void * var, MGUI_bind_type type);
+void mgui_unbind(const char * obj_name);
+
+/* Handler of events from an object, see mgui_on() */
+typedef void (*MGUI_event_cb)(MGUI_event * event, void * arg);
+
+bool mgui_on(const char * obj_name, const char * event, MGUI_event_cb cb, void * arg, bool worker);
+bool mgui_on(const char * obj_name, const char * event, MGUI_event_cb cb, void * arg);
+bool mgui_on(const char * obj_name, MGUI_event_cb cb);
+void mgui_off(const char * obj_name, const char * event);
+
+/* Power states of the display, see mgui_set_idle() */
+typedef enum {
+  MGUI_POWER_ACTIVE,
+  MGUI_POWER_IDLE,
+  MGUI_POWER_DIM,
+  MGUI_POWER_SLEEP
+} MGUI_power;
+
+void mgui_set_idle(uint32_t dim_ms, uint32_t sleep_ms);
+void mgui_wake();
+MGUI_power mgui_get_power();
+
+void mgui_show_page(uint8_t page);
+uint8_t mgui_get_page();
+
+const MGUI_stats * mgui_get_stats();
+const MGUI_mem * mgui_mem_report();
+const MGUI_boot * mgui_get_boot();
+void mgui_mem_print();
+
+bool mgui_record_start();
+size_t mgui_record_stop();
+const uint8_t * mgui_trace_data(size_t * len);
+bool mgui_replay(const uint8_t * data, size_t len, float speed);
+void mgui_replay_stop();
+const MGUI_replay * mgui_replay_report();
+
 #endif
\ No newline at end of file
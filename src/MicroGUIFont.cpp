@@ -0,0 +1,418 @@
+//
+//   Runtime font loading for MicroGUI Embedded
+//
+//   Fonts are read on demand from LVGL binary font files (made with lv_font_conv --format bin --no-compress),
+//   one file per size, e.g. "S:/littlefs/fonts/24.bin". Only the glyphs that are actually drawn are read,
+//   and their bitmaps are kept in a small LRU cache in RAM.
+//
+
+#include <Arduino.h>
+
+#include "MicroGUI.h"
+
+#ifdef MGUI_FONT_FILES
+
+#include <LinkedList.h>
+
+/* Header table of an LVGL binary font */
+typedef struct {
+  uint32_t version;
+  uint16_t tables_count;
+  uint16_t font_size;
+  uint16_t ascent;
+  int16_t descent;
+  uint16_t typo_ascent;
+  int16_t typo_descent;
+  uint16_t typo_line_gap;
+  int16_t min_y;
+  int16_t max_y;
+  uint16_t default_advance_width;
+  uint16_t kerning_scale;
+  uint8_t index_to_loc_format;
+  uint8_t glyph_id_format;
+  uint8_t advance_width_format;
+  uint8_t bits_per_pixel;
+  uint8_t xy_bits;
+  uint8_t wh_bits;
+  uint8_t advance_width_bits;
+  uint8_t compression_id;
+  uint8_t subpixels_mode;
+  uint8_t padding;
+  int16_t underline_position;
+  uint16_t underline_thickness;
+} MGUI_font_header;
+
+/* One character map subtable of an LVGL binary font */
+typedef struct {
+  uint32_t data_offset;
+  uint32_t range_start;
+  uint16_t range_length;
+  uint16_t glyph_id_start;
+  uint16_t data_entries_count;
+  uint8_t format_type;
+  uint8_t padding;
+} MGUI_font_cmap;
+
+/* Character map formats, same as lv_font_fmt_txt_cmap_type_t */
+enum {
+  MGUI_CMAP_FORMAT0_FULL,
+  MGUI_CMAP_SPARSE_FULL,
+  MGUI_CMAP_FORMAT0_TINY,
+  MGUI_CMAP_SPARSE_TINY
+};
+
+/* A font loaded from a file, only the tables needed to locate glyphs are kept in RAM */
+typedef struct {
+  lv_font_t font;
+  uint8_t size;
+  lv_fs_file_t file;
+  MGUI_font_header header;
+  MGUI_font_cmap * cmaps;
+  uint16_t cmap_count;
+  uint16_t ** cmap_unicodes;    // Unicode list of each sparse subtable
+  void ** cmap_glyph_ids;       // Glyph id offset list of each full subtable
+  uint32_t * loca;              // Glyph offsets in the glyph table, loca_count + 1 entries
+  uint32_t loca_count;
+  uint32_t glyf_start;
+} MGUI_font_file;
+
+/* A cached glyph */
+typedef struct {
+  const lv_font_t * font;
+  uint32_t letter;
+  lv_font_glyph_dsc_t dsc;
+  uint8_t * bitmap;
+  uint16_t size;
+  uint32_t used;      // For finding the least recently used glyph
+  bool valid;
+  bool missing;       // The font has no glyph for this letter
+} MGUI_glyph;
+
+static LinkedList<MGUI_font_file*> font_files;
+
+static MGUI_glyph glyph_cache[MGUI_GLYPH_CACHE_ENTRIES];
+static uint32_t glyph_cache_bytes = 0;
+static uint32_t glyph_cache_tick = 0;
+static MGUI_glyph * glyph_last = NULL;
+
+/* Reads bits MSB first from a byte buffer */
+typedef struct {
+  const uint8_t * data;
+  uint32_t pos;
+} MGUI_bit_reader;
+
+static uint32_t mgui_read_bits(MGUI_bit_reader * it, uint8_t n) {
+  uint32_t value = 0;
+  for(uint8_t i = 0; i < n; i++) {
+    value = (value << 1) | ((it->data[it->pos >> 3] >> (7 - (it->pos & 7))) & 1);
+    it->pos++;
+  }
+  return value;
+}
+
+static int32_t mgui_read_bits_signed(MGUI_bit_reader * it, uint8_t n) {
+  uint32_t value = mgui_read_bits(it, n);
+  if(n && (value & (1UL << (n - 1)))) {
+    value |= ~0UL << n;
+  }
+  return (int32_t)value;
+}
+
+/* Reads the length and checks the label of a table, returns the length or -1 */
+static int32_t mgui_font_read_label(lv_fs_file_t * file, uint32_t start, const char * label) {
+  uint32_t length;
+  char buf[4];
+  if(lv_fs_seek(file, start, LV_FS_SEEK_SET) != LV_FS_RES_OK) return -1;
+  if(lv_fs_read(file, &length, 4, NULL) != LV_FS_RES_OK) return -1;
+  if(lv_fs_read(file, buf, 4, NULL) != LV_FS_RES_OK || memcmp(buf, label, 4) != 0) return -1;
+  return length;
+}
+
+/* Find the glyph id of a letter, 0 if the font does not have it */
+static uint32_t mgui_font_glyph_id(const MGUI_font_file * ff, uint32_t letter) {
+  for(uint16_t i = 0; i < ff->cmap_count; i++) {
+    const MGUI_font_cmap * cmap = &ff->cmaps[i];
+    if(letter < cmap->range_start) continue;
+    uint32_t rcp = letter - cmap->range_start;
+    if(rcp > cmap->range_length) continue;
+
+    switch(cmap->format_type) {
+      case MGUI_CMAP_FORMAT0_TINY:
+        return cmap->glyph_id_start + rcp;
+      case MGUI_CMAP_FORMAT0_FULL:
+        return cmap->glyph_id_start + ((uint8_t*)ff->cmap_glyph_ids[i])[rcp];
+      case MGUI_CMAP_SPARSE_TINY:
+      case MGUI_CMAP_SPARSE_FULL:
+        for(uint16_t j = 0; j < cmap->data_entries_count; j++) {
+          if(ff->cmap_unicodes[i][j] != rcp) continue;
+          if(cmap->format_type == MGUI_CMAP_SPARSE_TINY) return cmap->glyph_id_start + j;
+          return cmap->glyph_id_start + ((uint16_t*)ff->cmap_glyph_ids[i])[j];
+        }
+        break;
+    }
+  }
+  return 0;
+}
+
+/* Make room for size more bytes in the glyph cache and return a free entry */
+static MGUI_glyph * mgui_glyph_evict(uint16_t size) {
+  MGUI_glyph * slot = NULL;
+  while(true) {
+    MGUI_glyph * oldest = NULL;
+    slot = NULL;
+    for(uint16_t i = 0; i < MGUI_GLYPH_CACHE_ENTRIES; i++) {
+      if(!glyph_cache[i].valid) {
+        slot = &glyph_cache[i];
+      } else if(oldest == NULL || glyph_cache[i].used < oldest->used) {
+        oldest = &glyph_cache[i];
+      }
+    }
+    if(slot != NULL && glyph_cache_bytes + size <= MGUI_GLYPH_CACHE_SIZE) return slot;
+    if(oldest == NULL) return slot;
+
+    free(oldest->bitmap);
+    glyph_cache_bytes -= oldest->size;
+    oldest->bitmap = NULL;
+    oldest->valid = false;
+    if(glyph_last == oldest) glyph_last = NULL;
+  }
+}
+
+/* Returns a cached glyph, reading it from the font file if needed */
+static MGUI_glyph * mgui_glyph_get(const lv_font_t * font, uint32_t letter) {
+  if(glyph_last != NULL && glyph_last->font == font && glyph_last->letter == letter) {
+    glyph_last->used = ++glyph_cache_tick;
+    return glyph_last;
+  }
+  for(uint16_t i = 0; i < MGUI_GLYPH_CACHE_ENTRIES; i++) {
+    if(glyph_cache[i].valid && glyph_cache[i].font == font && glyph_cache[i].letter == letter) {
+      glyph_last = &glyph_cache[i];
+      glyph_last->used = ++glyph_cache_tick;
+      return glyph_last;
+    }
+  }
+
+  // Cache miss, read the glyph from its file
+  MGUI_font_file * ff = (MGUI_font_file*)font->dsc;
+  uint32_t id = mgui_font_glyph_id(ff, letter);
+  uint8_t * bitmap = NULL;
+  uint16_t bitmap_size = 0;
+  lv_font_glyph_dsc_t dsc = {};
+
+  if(id != 0 && id < ff->loca_count) {
+    uint32_t length = ff->loca[id + 1] - ff->loca[id];
+    uint8_t * data = (uint8_t*)malloc(length + 1);
+    if(data == NULL) return NULL;
+
+    if(lv_fs_seek(&ff->file, ff->glyf_start + ff->loca[id], LV_FS_SEEK_SET) != LV_FS_RES_OK ||
+       lv_fs_read(&ff->file, data, length, NULL) != LV_FS_RES_OK) {
+      free(data);
+      return NULL;
+    }
+    data[length] = 0;
+
+    // Glyph metrics are bit packed in front of the bitmap
+    MGUI_bit_reader it = {data, 0};
+    MGUI_font_header * h = &ff->header;
+    uint32_t adv_w = h->advance_width_bits == 0 ? h->default_advance_width : mgui_read_bits(&it, h->advance_width_bits);
+    if(h->advance_width_format == 0) adv_w *= 16;
+    dsc.adv_w = (adv_w + (1 << 3)) >> 4;     // Stored in 1/16 pixels
+    dsc.ofs_x = mgui_read_bits_signed(&it, h->xy_bits);
+    dsc.ofs_y = mgui_read_bits_signed(&it, h->xy_bits);
+    dsc.box_w = mgui_read_bits(&it, h->wh_bits);
+    dsc.box_h = mgui_read_bits(&it, h->wh_bits);
+    dsc.bpp = h->bits_per_pixel;
+
+    // The bitmap follows directly after the metrics, not byte aligned, so it is shifted into place
+    uint32_t nbits = it.pos;
+    bitmap_size = length - nbits / 8;
+    if(bitmap_size > 0) {
+      bitmap = (uint8_t*)malloc(bitmap_size);
+      if(bitmap == NULL) {
+        free(data);
+        return NULL;
+      }
+      for(uint16_t k = 0; k < bitmap_size; k++) {
+        uint8_t bits = (it.pos + 8 <= length * 8) ? 8 : length * 8 - it.pos;
+        bitmap[k] = mgui_read_bits(&it, bits) << (8 - bits);
+      }
+    }
+    free(data);
+  }
+
+  MGUI_glyph * glyph = mgui_glyph_evict(bitmap_size);
+  if(glyph == NULL) {
+    free(bitmap);
+    return NULL;
+  }
+  glyph->font = font;
+  glyph->letter = letter;
+  glyph->dsc = dsc;
+  glyph->bitmap = bitmap;
+  glyph->size = bitmap_size;
+  glyph->missing = (id == 0);
+  glyph->used = ++glyph_cache_tick;
+  glyph->valid = true;
+  glyph_cache_bytes += bitmap_size;
+  glyph_last = glyph;
+  return glyph;
+}
+
+/* LVGL font callback for glyph metrics */
+static bool mgui_font_get_glyph_dsc(const lv_font_t * font, lv_font_glyph_dsc_t * dsc_out, uint32_t letter, uint32_t letter_next) {
+  MGUI_glyph * glyph = mgui_glyph_get(font, letter);
+  if(glyph == NULL || glyph->missing) return false;
+
+  *dsc_out = glyph->dsc;
+  dsc_out->is_placeholder = 0;
+  return true;
+}
+
+/* LVGL font callback for glyph bitmaps, always called right after the metrics of the same letter */
+static const uint8_t * mgui_font_get_glyph_bitmap(const lv_font_t * font, uint32_t letter) {
+  MGUI_glyph * glyph = mgui_glyph_get(font, letter);
+  if(glyph == NULL) return NULL;
+  return glyph->bitmap;
+}
+
+/* Free a font that failed to load */
+static void mgui_font_free(MGUI_font_file * ff, bool opened) {
+  for(uint16_t i = 0; ff->cmap_unicodes != NULL && ff->cmap_glyph_ids != NULL && i < ff->cmap_count; i++) {
+    free(ff->cmap_unicodes[i]);
+    free(ff->cmap_glyph_ids[i]);
+  }
+  free(ff->cmaps);
+  free(ff->cmap_unicodes);
+  free(ff->cmap_glyph_ids);
+  free(ff->loca);
+  if(opened) lv_fs_close(&ff->file);
+  delete ff;
+}
+
+/* Open a font file and read the tables needed to locate glyphs */
+static MGUI_font_file * mgui_font_open(uint8_t size) {
+  char path[64];
+  snprintf(path, sizeof(path), "%s/%u.bin", MGUI_FONT_DIR, size);
+
+  MGUI_font_file * ff = new MGUI_font_file();
+  if(lv_fs_open(&ff->file, path, LV_FS_MODE_RD) != LV_FS_RES_OK) {
+    delete ff;
+    return NULL;
+  }
+
+  // Header
+  int32_t head_length = mgui_font_read_label(&ff->file, 0, "head");
+  if(head_length < 0 || lv_fs_read(&ff->file, &ff->header, sizeof(MGUI_font_header), NULL) != LV_FS_RES_OK) {
+    mgui_font_free(ff, true);
+    return NULL;
+  }
+  if(ff->header.compression_id != 0) {
+    Serial.printf("[MicroGUI]: Font %s is compressed, generate it with --no-compress\n", path);
+    mgui_font_free(ff, true);
+    return NULL;
+  }
+
+  // Character maps, kept in RAM since every glyph lookup needs them
+  uint32_t cmap_start = head_length;
+  int32_t cmap_length = mgui_font_read_label(&ff->file, cmap_start, "cmap");
+  uint32_t cmap_count = 0;
+  if(cmap_length < 0 || lv_fs_read(&ff->file, &cmap_count, 4, NULL) != LV_FS_RES_OK) {
+    mgui_font_free(ff, true);
+    return NULL;
+  }
+  ff->cmaps = (MGUI_font_cmap*)calloc(cmap_count, sizeof(MGUI_font_cmap));
+  ff->cmap_unicodes = (uint16_t**)calloc(cmap_count, sizeof(uint16_t*));
+  ff->cmap_glyph_ids = (void**)calloc(cmap_count, sizeof(void*));
+  if(ff->cmaps == NULL || ff->cmap_unicodes == NULL || ff->cmap_glyph_ids == NULL ||
+     lv_fs_read(&ff->file, ff->cmaps, cmap_count * sizeof(MGUI_font_cmap), NULL) != LV_FS_RES_OK) {
+    mgui_font_free(ff, true);
+    return NULL;
+  }
+  ff->cmap_count = cmap_count;
+
+  for(uint32_t i = 0; i < cmap_count; i++) {
+    MGUI_font_cmap * cmap = &ff->cmaps[i];
+    uint16_t count = cmap->data_entries_count;
+    lv_fs_seek(&ff->file, cmap_start + cmap->data_offset, LV_FS_SEEK_SET);
+
+    if(cmap->format_type == MGUI_CMAP_SPARSE_FULL || cmap->format_type == MGUI_CMAP_SPARSE_TINY) {
+      ff->cmap_unicodes[i] = (uint16_t*)malloc(count * sizeof(uint16_t));
+      if(ff->cmap_unicodes[i] == NULL || lv_fs_read(&ff->file, ff->cmap_unicodes[i], count * sizeof(uint16_t), NULL) != LV_FS_RES_OK) {
+        mgui_font_free(ff, true);
+        return NULL;
+      }
+    }
+    if(cmap->format_type == MGUI_CMAP_SPARSE_FULL || cmap->format_type == MGUI_CMAP_FORMAT0_FULL) {
+      uint32_t bytes = count * (cmap->format_type == MGUI_CMAP_SPARSE_FULL ? sizeof(uint16_t) : sizeof(uint8_t));
+      ff->cmap_glyph_ids[i] = malloc(bytes);
+      if(ff->cmap_glyph_ids[i] == NULL || lv_fs_read(&ff->file, ff->cmap_glyph_ids[i], bytes, NULL) != LV_FS_RES_OK) {
+        mgui_font_free(ff, true);
+        return NULL;
+      }
+    }
+  }
+
+  // Glyph locations
+  uint32_t loca_start = cmap_start + cmap_length;
+  int32_t loca_length = mgui_font_read_label(&ff->file, loca_start, "loca");
+  if(loca_length < 0 || lv_fs_read(&ff->file, &ff->loca_count, 4, NULL) != LV_FS_RES_OK) {
+    mgui_font_free(ff, true);
+    return NULL;
+  }
+  uint32_t glyf_start = loca_start + loca_length;
+  int32_t glyf_length = mgui_font_read_label(&ff->file, glyf_start, "glyf");
+  ff->loca = (uint32_t*)malloc((ff->loca_count + 1) * sizeof(uint32_t));
+  if(glyf_length < 0 || ff->loca == NULL) {
+    mgui_font_free(ff, true);
+    return NULL;
+  }
+
+  lv_fs_seek(&ff->file, loca_start + 12, LV_FS_SEEK_SET);
+  for(uint32_t i = 0; i < ff->loca_count; i++) {
+    if(ff->header.index_to_loc_format == 0) {
+      uint16_t offset = 0;
+      lv_fs_read(&ff->file, &offset, sizeof(uint16_t), NULL);
+      ff->loca[i] = offset;
+    } else {
+      lv_fs_read(&ff->file, &ff->loca[i], sizeof(uint32_t), NULL);
+    }
+  }
+  ff->loca[ff->loca_count] = glyf_length;     // End of the last glyph
+  ff->glyf_start = glyf_start;
+
+  ff->size = size;
+  ff->font.get_glyph_dsc = mgui_font_get_glyph_dsc;
+  ff->font.get_glyph_bitmap = mgui_font_get_glyph_bitmap;
+  ff->font.line_height = ff->header.ascent - ff->header.descent;
+  ff->font.base_line = -ff->header.descent;
+  ff->font.subpx = LV_FONT_SUBPX_NONE;
+  ff->font.underline_position = ff->header.underline_position;
+  ff->font.underline_thickness = ff->header.underline_thickness;
+  ff->font.dsc = ff;
+  ff->font.fallback = LV_FONT_DEFAULT;     // Letters missing from the file are drawn with the built-in font
+
+  Serial.printf("[MicroGUI]: Loaded font %s\n", path);
+  return ff;
+}
+
+/* Returns the font of a size loaded from file, or NULL if there is no such file */
+const lv_font_t * mgui_font_file(uint8_t size) {
+  for(int i = 0; i < font_files.size(); i++) {
+    if(font_files.get(i)->size == size) {
+      return &font_files.get(i)->font;
+    }
+  }
+
+  MGUI_font_file * ff = mgui_font_open(size);
+  if(ff == NULL) return NULL;
+  font_files.add(ff);
+  return &ff->font;
+}
+
+#else
+
+const lv_font_t * mgui_font_file(uint8_t size) {
+  return NULL;
+}
+
+#endif
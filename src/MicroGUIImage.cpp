@@ -0,0 +1,344 @@
+//
+//   Image assets for MicroGUI Embedded
+//
+//   Images are stored run-length encoded, either compiled into flash and registered with mgui_image_register(),
+//   or as files on a filesystem, e.g. "S:/littlefs/icons/wifi.mgi". A decoder registered with LVGL keeps decoded
+//   images in a size bounded LRU cache, images too large for the cache are decoded row by row while drawn.
+//
+//   MGI1 format, all values little endian:
+//     char     magic[4]                "MGI1"
+//     uint16   width, height
+//     uint32   row_offsets[height]     Offset of each row from the start of the pixel data
+//     uint8    pixel data              Every row on its own, as packets of a count byte n followed by
+//                                      n + 1 RGB565 pixels if n < 128, or one RGB565 pixel repeated n - 127 times
+//
+
+#include <Arduino.h>
+
+#include "MicroGUI.h"
+
+#include <LinkedList.h>
+#include <esp_heap_caps.h>
+
+#define MGUI_IMAGE_HEADER_SIZE 8
+
+/* An image compiled into flash */
+typedef struct {
+  char name[32];
+  lv_img_dsc_t dsc;         // Given to LVGL as image source, LV_IMG_CF_RAW with data pointing at the MGI1 image
+} MGUI_image_asset;
+
+/* A decoded image in the cache */
+typedef struct {
+  const void * src;         // Asset descriptor, or NULL for files
+  char * path;              // File path, or NULL for assets
+  uint8_t * pixels;
+  uint32_t size;
+  uint32_t last_used;
+  uint16_t users;           // Open decoder descriptors drawing from pixels, the entry may not be evicted while used
+} MGUI_image_entry;
+
+/* Reading position in an image that is decoded row by row */
+typedef struct {
+  const uint8_t * data;     // An asset in flash, or NULL when reading from file
+  lv_fs_file_t file;
+  uint32_t data_size;       // Size of the whole MGI1 image
+  uint16_t width;
+  uint16_t height;
+  int32_t row;              // Row currently in row_buf, -1 if none
+  uint16_t * row_buf;
+  uint8_t * packed_buf;     // One encoded row read from file
+} MGUI_image_stream;
+
+static LinkedList<MGUI_image_asset*> assets;
+static LinkedList<MGUI_image_entry*> cache;
+static uint32_t cache_used = 0;
+static uint32_t cache_tick = 0;
+
+/* Returns true if an image source is an MGI1 image */
+static bool mgui_image_is_mgi(const void * src) {
+  lv_img_src_t type = lv_img_src_get_type(src);
+  if(type == LV_IMG_SRC_VARIABLE) {
+    const lv_img_dsc_t * dsc = (const lv_img_dsc_t*)src;
+    return dsc->header.cf == LV_IMG_CF_RAW && dsc->data_size >= MGUI_IMAGE_HEADER_SIZE && memcmp(dsc->data, "MGI1", 4) == 0;
+  }
+  if(type == LV_IMG_SRC_FILE) {
+    const char * ext = strrchr((const char*)src, '.');
+    return ext != NULL && strcmp(ext, ".mgi") == 0;
+  }
+  return false;
+}
+
+/* Read bytes at an offset from the start of the image */
+static bool mgui_image_read(MGUI_image_stream * stream, uint32_t offset, void * buf, uint32_t len) {
+  if(offset + len > stream->data_size) return false;
+  if(stream->data != NULL) {
+    memcpy(buf, stream->data + offset, len);
+    return true;
+  }
+  uint32_t read = 0;
+  if(lv_fs_seek(&stream->file, offset, LV_FS_SEEK_SET) != LV_FS_RES_OK) return false;
+  return lv_fs_read(&stream->file, buf, len, &read) == LV_FS_RES_OK && read == len;
+}
+
+/* Open an MGI1 image for reading, returns NULL if it is not one */
+static MGUI_image_stream * mgui_image_open(const void * src) {
+  MGUI_image_stream * stream = (MGUI_image_stream*)calloc(1, sizeof(MGUI_image_stream));
+  if(stream == NULL) return NULL;
+  stream->row = -1;
+
+  if(lv_img_src_get_type(src) == LV_IMG_SRC_VARIABLE) {
+    stream->data = ((const lv_img_dsc_t*)src)->data;
+    stream->data_size = ((const lv_img_dsc_t*)src)->data_size;
+  } else {
+    if(lv_fs_open(&stream->file, (const char*)src, LV_FS_MODE_RD) != LV_FS_RES_OK) {
+      free(stream);
+      return NULL;
+    }
+    lv_fs_seek(&stream->file, 0, LV_FS_SEEK_END);
+    lv_fs_tell(&stream->file, &stream->data_size);
+  }
+
+  uint8_t header[MGUI_IMAGE_HEADER_SIZE];
+  if(!mgui_image_read(stream, 0, header, sizeof(header)) || memcmp(header, "MGI1", 4) != 0) {
+    if(stream->data == NULL) lv_fs_close(&stream->file);
+    free(stream);
+    return NULL;
+  }
+  stream->width = header[4] | header[5] << 8;
+  stream->height = header[6] | header[7] << 8;
+  return stream;
+}
+
+static void mgui_image_close(MGUI_image_stream * stream) {
+  if(stream->data == NULL) lv_fs_close(&stream->file);
+  free(stream->row_buf);
+  free(stream->packed_buf);
+  free(stream);
+}
+
+/* Unpack one run-length encoded row */
+static bool mgui_image_unpack(const uint8_t * in, uint32_t len, uint16_t * out, uint16_t width) {
+  uint32_t i = 0;
+  uint16_t x = 0;
+  while(x < width && i < len) {
+    uint8_t n = in[i++];
+    if(n < 128) {
+      uint16_t count = n + 1;
+      if(x + count > width || i + count * 2 > len) return false;
+      memcpy(out + x, in + i, count * 2);
+      i += count * 2;
+      x += count;
+    } else {
+      uint16_t count = n - 127;
+      if(x + count > width || i + 2 > len) return false;
+      uint16_t color = in[i] | in[i + 1] << 8;
+      i += 2;
+      while(count--) out[x++] = color;
+    }
+  }
+  return x == width;
+}
+
+/* Decode one row of the image into out, width pixels */
+static bool mgui_image_decode_row(MGUI_image_stream * stream, uint16_t y, uint16_t * out) {
+  uint32_t table = MGUI_IMAGE_HEADER_SIZE + 4 * (uint32_t)stream->height;
+  uint32_t offsets[2];
+  if(!mgui_image_read(stream, MGUI_IMAGE_HEADER_SIZE + 4 * (uint32_t)y, offsets, y + 1 < stream->height ? 8 : 4)) return false;
+  uint32_t start = table + offsets[0];
+  uint32_t end = y + 1 < stream->height ? table + offsets[1] : stream->data_size;
+  if(end < start || end > stream->data_size) return false;
+
+  // Assets are unpacked straight from flash, file rows are read into a buffer first
+  if(stream->data != NULL) {
+    return mgui_image_unpack(stream->data + start, end - start, out, stream->width);
+  }
+
+  uint32_t max_len = (uint32_t)stream->width * 3;    // A row of one pixel runs, worst case
+  if(end - start > max_len) return false;
+  if(stream->packed_buf == NULL) {
+    stream->packed_buf = (uint8_t*)malloc(max_len);
+    if(stream->packed_buf == NULL) return false;
+  }
+  return mgui_image_read(stream, start, stream->packed_buf, end - start) && mgui_image_unpack(stream->packed_buf, end - start, out, stream->width);
+}
+
+/* Find a decoded image in the cache */
+static MGUI_image_entry * mgui_image_cached(const void * src) {
+  bool file = lv_img_src_get_type(src) == LV_IMG_SRC_FILE;
+  for(int i = 0; i < cache.size(); i++) {
+    MGUI_image_entry * entry = cache.get(i);
+    if(file ? (entry->path != NULL && strcmp(entry->path, (const char*)src) == 0) : entry->src == src) {
+      return entry;
+    }
+  }
+  return NULL;
+}
+
+/* Evict least recently used images that are not being drawn until size more bytes fit in the cache */
+static bool mgui_image_make_room(uint32_t size) {
+  while(cache_used + size > MGUI_IMAGE_CACHE_SIZE) {
+    int oldest = -1;
+    for(int i = 0; i < cache.size(); i++) {
+      MGUI_image_entry * entry = cache.get(i);
+      if(entry->users == 0 && (oldest < 0 || entry->last_used < cache.get(oldest)->last_used)) oldest = i;
+    }
+    if(oldest < 0) return false;
+
+    MGUI_image_entry * entry = cache.remove(oldest);
+    cache_used -= entry->size;
+    heap_caps_free(entry->pixels);
+    free(entry->path);
+    free(entry);
+  }
+  return true;
+}
+
+/* Decode a whole image into the cache, returns NULL if it does not fit */
+static MGUI_image_entry * mgui_image_cache_add(const void * src, MGUI_image_stream * stream) {
+  uint32_t size = (uint32_t)stream->width * stream->height * sizeof(uint16_t);
+  if(size > MGUI_IMAGE_CACHE_SIZE || !mgui_image_make_room(size)) return NULL;
+
+  MGUI_image_entry * entry = (MGUI_image_entry*)calloc(1, sizeof(MGUI_image_entry));
+  if(entry == NULL) return NULL;
+  entry->pixels = (uint8_t*)heap_caps_malloc(size, MALLOC_CAP_SPIRAM);
+  if(entry->pixels == NULL) entry->pixels = (uint8_t*)heap_caps_malloc(size, MALLOC_CAP_8BIT);
+  if(lv_img_src_get_type(src) == LV_IMG_SRC_FILE) {
+    entry->path = strdup((const char*)src);
+  } else {
+    entry->src = src;
+  }
+
+  bool ok = entry->pixels != NULL && (entry->src != NULL || entry->path != NULL);
+  for(uint16_t y = 0; ok && y < stream->height; y++) {
+    ok = mgui_image_decode_row(stream, y, (uint16_t*)entry->pixels + (uint32_t)y * stream->width);
+  }
+  if(!ok) {
+    heap_caps_free(entry->pixels);
+    free(entry->path);
+    free(entry);
+    return NULL;
+  }
+
+  entry->size = size;
+  cache_used += size;
+  cache.add(entry);
+  return entry;
+}
+
+/* LVGL decoder callbacks */
+
+static lv_res_t mgui_image_info(lv_img_decoder_t * decoder, const void * src, lv_img_header_t * header) {
+  if(!mgui_image_is_mgi(src)) return LV_RES_INV;
+
+  MGUI_image_stream * stream = mgui_image_open(src);
+  if(stream == NULL) return LV_RES_INV;
+
+  header->always_zero = 0;
+  header->cf = LV_IMG_CF_TRUE_COLOR;
+  header->w = stream->width;
+  header->h = stream->height;
+  mgui_image_close(stream);
+  return LV_RES_OK;
+}
+
+static lv_res_t mgui_image_open_cb(lv_img_decoder_t * decoder, lv_img_decoder_dsc_t * dsc) {
+  if(!mgui_image_is_mgi(dsc->src)) return LV_RES_INV;
+
+  // img_data tells close which kind of user_data it gets, a cache entry when set, a stream otherwise
+  MGUI_image_entry * entry = mgui_image_cached(dsc->src);
+  if(entry == NULL) {
+    MGUI_image_stream * stream = mgui_image_open(dsc->src);
+    if(stream == NULL) return LV_RES_INV;
+
+    entry = mgui_image_cache_add(dsc->src, stream);
+    if(entry == NULL) {
+      // Too large for the cache, decode rows as LVGL asks for them
+      stream->row_buf = (uint16_t*)malloc(stream->width * sizeof(uint16_t));
+      if(stream->row_buf == NULL) {
+        mgui_image_close(stream);
+        return LV_RES_INV;
+      }
+      dsc->img_data = NULL;
+      dsc->user_data = stream;
+      return LV_RES_OK;
+    }
+    mgui_image_close(stream);
+  }
+
+  entry->users++;
+  entry->last_used = ++cache_tick;
+  dsc->img_data = entry->pixels;
+  dsc->user_data = entry;
+  return LV_RES_OK;
+}
+
+static lv_res_t mgui_image_read_line(lv_img_decoder_t * decoder, lv_img_decoder_dsc_t * dsc, lv_coord_t x, lv_coord_t y, lv_coord_t len, uint8_t * buf) {
+  MGUI_image_stream * stream = (MGUI_image_stream*)dsc->user_data;
+  if(y >= stream->height || x + len > stream->width) return LV_RES_INV;
+
+  // LVGL may read a row in several parts, it is only decoded once
+  if(stream->row != y) {
+    if(!mgui_image_decode_row(stream, y, stream->row_buf)) {
+      stream->row = -1;
+      return LV_RES_INV;
+    }
+    stream->row = y;
+  }
+  memcpy(buf, stream->row_buf + x, len * sizeof(uint16_t));
+  return LV_RES_OK;
+}
+
+static void mgui_image_close_cb(lv_img_decoder_t * decoder, lv_img_decoder_dsc_t * dsc) {
+  if(dsc->img_data != NULL) {
+    ((MGUI_image_entry*)dsc->user_data)->users--;
+  } else if(dsc->user_data != NULL) {
+    mgui_image_close((MGUI_image_stream*)dsc->user_data);
+  }
+  dsc->user_data = NULL;
+}
+
+/* Register the MicroGUI image decoder with LVGL, called after lv_init() */
+void mgui_image_init() {
+  lv_img_decoder_t * decoder = lv_img_decoder_create();
+  lv_img_decoder_set_info_cb(decoder, mgui_image_info);
+  lv_img_decoder_set_open_cb(decoder, mgui_image_open_cb);
+  lv_img_decoder_set_read_line_cb(decoder, mgui_image_read_line);
+  lv_img_decoder_set_close_cb(decoder, mgui_image_close_cb);
+}
+
+/* Make an MGI1 image in flash available to GUI documents under a name */
+bool mgui_image_register(const char * name, const uint8_t * data, uint32_t size) {
+  if(size < MGUI_IMAGE_HEADER_SIZE || memcmp(data, "MGI1", 4) != 0) {
+    Serial.print(F("[MicroGUI]: Not an MGI1 image: "));
+    Serial.println(name);
+    return false;
+  }
+  if(strlen(name) >= sizeof(((MGUI_image_asset*)0)->name) || mgui_image_src(name) != NULL) {
+    Serial.print(F("[MicroGUI]: Image name too long or already registered: "));
+    Serial.println(name);
+    return false;
+  }
+
+  MGUI_image_asset * asset = (MGUI_image_asset*)calloc(1, sizeof(MGUI_image_asset));
+  if(asset == NULL) return false;
+  strcpy(asset->name, name);
+  asset->dsc.header.cf = LV_IMG_CF_RAW;
+  asset->dsc.header.w = data[4] | data[5] << 8;
+  asset->dsc.header.h = data[6] | data[7] << 8;
+  asset->dsc.data = data;
+  asset->dsc.data_size = size;
+  assets.add(asset);
+  return true;
+}
+
+/* Returns the LVGL image source for an image name from a GUI document, a registered asset or a file path */
+const void * mgui_image_src(const char * name) {
+  if(name == NULL) return NULL;
+  for(int i = 0; i < assets.size(); i++) {
+    if(strcmp(assets.get(i)->name, name) == 0) return &assets.get(i)->dsc;
+  }
+  // File paths start with a drive letter, e.g. "S:/littlefs/icons/wifi.mgi"
+  if(name[0] >= 'A' && name[0] <= 'Z' && name[1] == ':') return name;
+  return NULL;
+}
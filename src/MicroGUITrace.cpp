@@ -0,0 +1,284 @@
+//
+//   Record and replay for MicroGUI Embedded
+//
+//   Touch samples from touchpad_read() and WebSocket messages from handleWebSocketMessage() are recorded with
+//   their timing into a trace. Replaying a trace feeds the same input back at the original or a faster pace,
+//   from a task of its own that hands messages to the GUI task like the network does, while the statistics
+//   of the GUI are collected into a report.
+//
+//   MGT1 format, all values little endian:
+//     char     magic[4]                "MGT1"
+//     records                          Each one a type byte, the milliseconds since the previous record
+//                                      as a varint and then
+//       MGUI_TRACE_PRESS, _RELEASE       int16 x, y
+//       MGUI_TRACE_MESSAGE               varint length and the text of the message
+//
+
+#include <Arduino.h>
+
+#include "MicroGUI.h"
+#include "RemoteMicroGUI.h"
+
+#include <esp_heap_caps.h>
+
+#define MGUI_TRACE_HEADER_SIZE 4
+#define MGUI_TRACE_TOUCH_QUEUE 16
+
+/* Record types */
+#define MGUI_TRACE_PRESS 1
+#define MGUI_TRACE_RELEASE 2
+#define MGUI_TRACE_MESSAGE 3
+
+typedef struct {
+  int16_t x;
+  int16_t y;
+  bool pressed;
+} MGUI_trace_touch;
+
+static uint8_t * trace = NULL;
+static size_t trace_len = 0;
+static uint32_t trace_last_ms = 0;
+static bool trace_full = false;
+static volatile bool recording = false;
+static portMUX_TYPE trace_mux = portMUX_INITIALIZER_UNLOCKED;
+static MGUI_trace_touch recorded_touch = {0, 0, false};
+
+static volatile bool replaying = false;
+static volatile bool replay_stop = false;
+static float replay_speed = 1;
+static QueueHandle_t touch_queue = NULL;
+static MGUI_trace_touch replayed_touch = {0, 0, false};
+static MGUI_replay report;
+
+/* Allocate the trace buffer, in PSRAM when available */
+static bool mgui_trace_alloc() {
+  if(trace != NULL) return true;
+  trace = (uint8_t*)heap_caps_malloc(MGUI_TRACE_SIZE, MALLOC_CAP_SPIRAM);
+  if(trace == NULL) trace = (uint8_t*)heap_caps_malloc(MGUI_TRACE_SIZE, MALLOC_CAP_8BIT);
+  if(trace == NULL) {
+    Serial.println("[MicroGUI]: Not enough memory for a trace");
+    return false;
+  }
+  return true;
+}
+
+static size_t mgui_varint_put(uint8_t * buf, uint32_t value) {
+  size_t n = 0;
+  while(value >= 0x80) {
+    buf[n++] = (value & 0x7F) | 0x80;
+    value >>= 7;
+  }
+  buf[n++] = value;
+  return n;
+}
+
+/* Read a varint, returns 0 if it runs past end */
+static size_t mgui_varint_get(const uint8_t * buf, const uint8_t * end, uint32_t * value) {
+  *value = 0;
+  for(size_t n = 0; n < 5 && buf + n < end; n++) {
+    *value |= (uint32_t)(buf[n] & 0x7F) << (7 * n);
+    if((buf[n] & 0x80) == 0) return n + 1;
+  }
+  return 0;
+}
+
+/* Append a record, may be called from any task. Recording stops when the trace is full */
+static void mgui_trace_append(uint8_t type, const uint8_t * payload, size_t len, bool prefix_len) {
+  uint8_t head[11];
+  portENTER_CRITICAL(&trace_mux);
+  if(recording) {
+    uint32_t now = millis();
+    size_t n = 0;
+    head[n++] = type;
+    n += mgui_varint_put(head + n, now - trace_last_ms);
+    if(prefix_len) n += mgui_varint_put(head + n, len);
+
+    if(trace_len + n + len <= MGUI_TRACE_SIZE) {
+      memcpy(trace + trace_len, head, n);
+      memcpy(trace + trace_len + n, payload, len);
+      trace_len += n + len;
+      trace_last_ms = now;
+    }
+    else {
+      recording = false;
+      trace_full = true;
+    }
+  }
+  portEXIT_CRITICAL(&trace_mux);
+}
+
+/* Start recording touch and WebSocket input, discards the previous trace */
+bool mgui_record_start() {
+  if(replaying || !mgui_trace_alloc()) return false;
+
+  portENTER_CRITICAL(&trace_mux);
+  memcpy(trace, "MGT1", MGUI_TRACE_HEADER_SIZE);
+  trace_len = MGUI_TRACE_HEADER_SIZE;
+  trace_last_ms = millis();
+  trace_full = false;
+  recorded_touch.pressed = false;
+  recording = true;
+  portEXIT_CRITICAL(&trace_mux);
+
+  Serial.println("[MicroGUI]: Recording started");
+  return true;
+}
+
+/* Stop recording, returns the length of the trace */
+size_t mgui_record_stop() {
+  recording = false;
+  if(trace_full) Serial.println("[MicroGUI]: Trace full, recording stopped early");
+  Serial.printf("[MicroGUI]: Recording stopped, %u bytes\n", (unsigned)trace_len);
+  return trace_len;
+}
+
+/* Returns the latest recorded or replayed trace */
+const uint8_t * mgui_trace_data(size_t * len) {
+  *len = trace != NULL ? trace_len : 0;
+  return trace;
+}
+
+/* Called by touchpad_read(), records the touch or replaces it with the replayed one */
+void mgui_trace_touch(lv_indev_data_t * data) {
+  if(replaying) {
+    // One sample per read so that no press or release is lost at a high replay speed
+    if(touch_queue != NULL) xQueueReceive(touch_queue, &replayed_touch, 0);
+    data->point.x = replayed_touch.x;
+    data->point.y = replayed_touch.y;
+    data->state = replayed_touch.pressed ? LV_INDEV_STATE_PR : LV_INDEV_STATE_REL;
+    return;
+  }
+  if(!recording) return;
+
+  // Only changes are recorded, a held touch is the same sample over and over
+  bool pressed = data->state == LV_INDEV_STATE_PR;
+  if(pressed == recorded_touch.pressed && (!pressed || (data->point.x == recorded_touch.x && data->point.y == recorded_touch.y))) return;
+  recorded_touch.x = data->point.x;
+  recorded_touch.y = data->point.y;
+  recorded_touch.pressed = pressed;
+
+  uint8_t payload[4];
+  memcpy(payload, &recorded_touch.x, 2);
+  memcpy(payload + 2, &recorded_touch.y, 2);
+  mgui_trace_append(pressed ? MGUI_TRACE_PRESS : MGUI_TRACE_RELEASE, payload, sizeof(payload), false);
+}
+
+/* Called by handleWebSocketMessage() for every whole text message */
+void mgui_trace_message(const uint8_t * data, size_t len) {
+  if(recording) mgui_trace_append(MGUI_TRACE_MESSAGE, data, len, true);
+}
+
+/* Plays the trace, waiting between records for their time divided by the replay speed */
+static void mgui_replay_task(void * param) {
+  const MGUI_stats * stats = mgui_stats_counters();    // Read from this task, the GUI keeps them
+  MGUI_stats before = *stats;
+  mgui_stats_reset_max();
+
+  uint32_t start = millis();
+  uint32_t at = 0;      // Time of the current record in the trace
+  const uint8_t * p = trace + MGUI_TRACE_HEADER_SIZE;
+  const uint8_t * end = trace + trace_len;
+
+  while(p < end && !replay_stop) {
+    uint8_t type = *p++;
+    uint32_t delta;
+    size_t n = mgui_varint_get(p, end, &delta);
+    if(n == 0) break;
+    p += n;
+    at += delta;
+
+    if(replay_speed > 0) {
+      int32_t wait = (int32_t)(at / replay_speed) - (int32_t)(millis() - start);
+      if(wait > 0) vTaskDelay(pdMS_TO_TICKS(wait));
+    }
+
+    if(type == MGUI_TRACE_PRESS || type == MGUI_TRACE_RELEASE) {
+      if(end - p < 4) break;
+      MGUI_trace_touch touch;
+      memcpy(&touch.x, p, 2);
+      memcpy(&touch.y, p + 2, 2);
+      touch.pressed = type == MGUI_TRACE_PRESS;
+      p += 4;
+      xQueueSend(touch_queue, &touch, portMAX_DELAY);
+      report.touches++;
+    }
+    else if(type == MGUI_TRACE_MESSAGE) {
+      uint32_t len;
+      n = mgui_varint_get(p, end, &len);
+      if(n == 0 || (size_t)(end - p - n) < len) break;
+      p += n;
+
+      // Handled by the GUI task, the same way as messages from WebSocket clients
+      if(mgui_remote_queue_message(0, p, len)) report.messages++;
+      p += len;
+    }
+    else {
+      Serial.println("[MicroGUI]: Unknown record in trace, replay stopped");
+      break;
+    }
+  }
+
+  // Let the GUI take the last touch samples before handing the touchpad back
+  while(uxQueueMessagesWaiting(touch_queue) > 0 && !replay_stop) vTaskDelay(pdMS_TO_TICKS(MGUI_REFR_ACTIVE));
+
+  report.duration_ms = millis() - start;
+  report.frames = stats->frames - before.frames;
+  report.frame_ms = stats->frame_ms - before.frame_ms;
+  report.max_frame_ms = stats->max_frame_ms;
+  report.flush_bus_us = stats->flush_bus_us - before.flush_bus_us;
+  report.touch_wait_max_us = stats->touch_wait_max_us;
+  report.events_dropped = stats->events_dropped - before.events_dropped;
+  report.running = false;
+  replaying = false;
+
+  Serial.printf("[MicroGUI]: Replay done in %lu ms, %lu frames, %lu ms average, %lu ms longest\n",
+                (unsigned long)report.duration_ms, (unsigned long)report.frames,
+                (unsigned long)(report.frames > 0 ? report.frame_ms / report.frames : 0), (unsigned long)report.max_frame_ms);
+  vTaskDelete(NULL);
+}
+
+/* Replay a trace, speed 1 for the original timing, 2 for twice as fast or 0 for as fast as possible.
+   The trace is copied, and is returned by mgui_trace_data() afterwards */
+bool mgui_replay(const uint8_t * data, size_t len, float speed) {
+  if(replaying || recording) return false;
+  if(len < MGUI_TRACE_HEADER_SIZE || len > MGUI_TRACE_SIZE || memcmp(data, "MGT1", MGUI_TRACE_HEADER_SIZE) != 0) {
+    Serial.println("[MicroGUI]: Not an MGT1 trace");
+    return false;
+  }
+  if(!mgui_trace_alloc()) return false;
+  if(touch_queue == NULL) {
+    touch_queue = xQueueCreate(MGUI_TRACE_TOUCH_QUEUE, sizeof(MGUI_trace_touch));
+    if(touch_queue == NULL) return false;
+  }
+
+  MGUI_trace_touch stale;
+  while(xQueueReceive(touch_queue, &stale, 0) == pdTRUE);    // Left over from a stopped replay
+
+  if(data != trace) memcpy(trace, data, len);
+  trace_len = len;
+  replay_speed = speed;
+  replay_stop = false;
+  replayed_touch.pressed = false;
+  memset(&report, 0, sizeof(report));
+  report.running = true;
+  replaying = true;
+
+  if(xTaskCreatePinnedToCore(mgui_replay_task, "mgui_replay", 8192, NULL, 1, NULL, 0) != pdPASS) {
+    Serial.println("[MicroGUI]: Could not start the replay");
+    report.running = false;
+    replaying = false;
+    return false;
+  }
+  Serial.println("[MicroGUI]: Replay started");
+  return true;
+}
+
+/* Stop a running replay */
+void mgui_replay_stop() {
+  replay_stop = true;
+}
+
+/* Returns what happened during the latest replay, running is true until it is done */
+const MGUI_replay * mgui_replay_report() {
+  return &report;
+}
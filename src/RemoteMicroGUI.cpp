@@ -20,6 +20,11 @@
 #include <Preferences.h>
 #include <DNSServer.h>
 
+#include <LinkedList.h>
+
+#include <memory>
+#include <esp_heap_caps.h>
+
 DNSServer dnsServer;
 AsyncWebServer server(80);
 AsyncWebSocket ws("/ws");
@@ -38,6 +43,95 @@ char parent[100];
 
 char IPTextField[100] = "default_IP";    // Name of textfield to display IP on when connected
 
+/* Changes to the GUI from the network side, applied by mgui_run() */
+typedef enum {
+  MGUI_GUI_SET_IP,
+  MGUI_GUI_SHOW_BORDER,
+  MGUI_GUI_HIDE_BORDER,
+  MGUI_GUI_APPLY_BATCH,
+  MGUI_GUI_MIRROR,
+  MGUI_GUI_MESSAGE,
+  MGUI_GUI_DISCONNECT,
+  MGUI_GUI_SNAPSHOT
+} MGUI_gui_command_type;
+
+/* Kinds of copies the GUI task makes for the network side */
+typedef enum {
+  MGUI_SNAPSHOT_DOCUMENT,
+  MGUI_SNAPSHOT_WIDGETS,    // GET /api/widgets
+  MGUI_SNAPSHOT_WIDGET      // GET /api/widgets/<name>
+} MGUI_snapshot_kind;
+
+#define MGUI_SNAPSHOT_TIMEOUT 500     // Milliseconds the network side waits for the GUI task to make a snapshot
+
+/* A copy of GUI state, made by the GUI task and owned by whoever sends it, so that it stays valid while it is sent */
+struct MGUI_snapshot {
+  MGUI_snapshot_kind kind;
+  char name[100] = "";            // Widget of MGUI_SNAPSHOT_WIDGET
+  bool found = true;              // False if there is no such widget
+  char * data = NULL;
+  size_t len = 0;
+  uint32_t hash = 0;              // Document hash and state of the GUI when the copy was made
+  uint32_t epoch = 0;
+  uint32_t version = 0;
+  SemaphoreHandle_t done = NULL;  // Given by the GUI task when the copy is made
+
+  ~MGUI_snapshot() {
+    if(data != NULL) heap_caps_free(data);
+    if(done != NULL) vSemaphoreDelete(done);
+  }
+};
+
+typedef struct {
+  MGUI_gui_command_type type;
+  char text[32];
+  DynamicJsonDocument * batch;    // Values from POST /api/widgets, freed when applied
+  uint32_t client_id;             // WebSocket message and the client that sent it, freed when handled
+  uint8_t * data;
+  size_t len;
+  std::shared_ptr<MGUI_snapshot> * snapshot;    // Reference held by the GUI task until the snapshot is made
+} MGUI_gui_command;
+
+/* WiFi events passed to the network task */
+typedef enum {
+  MGUI_NET_CONNECTED,
+  MGUI_NET_DISCONNECTED
+} MGUI_net_event;
+
+static QueueHandle_t gui_queue = NULL;
+static QueueHandle_t net_queue = NULL;      // Set while the network task runs
+static uint32_t reconnect_at = 0;           // When to try connecting again, 0 if not waiting
+static uint32_t reconnect_delay = 1000;
+static uint32_t last_cleanup = 0;
+
+/* Counters for /metrics */
+static uint32_t ws_messages = 0;            // WebSocket messages queued to a client
+static uint32_t ws_bytes = 0;
+static uint32_t ws_dropped = 0;             // Messages not sent as the client's queue was full
+static uint32_t wifi_disconnects = 0;
+static uint32_t wifi_reconnects = 0;        // Attempts to connect again after losing WiFi
+
+/* Count a message about to be sent to a client, which drops it if its' queue is full */
+static void countSent(AsyncWebSocketClient * client, size_t len) {
+  if(client == NULL) return;
+  if(client->queueIsFull()) {
+    ws_dropped++;
+    return;
+  }
+  ws_messages++;
+  ws_bytes += len;
+}
+
+/* Objects a WebSocket client has subscribed to, clients without a subscription receive everything.
+   Subscriptions are only used and changed on the GUI task, and object indices are only valid within the state epoch */
+typedef struct {
+  uint32_t client_id;
+  uint32_t * bits;      // One bit per object in the registry
+  uint16_t words;       // Length of bits, objects registered after subscribing are not included
+} MGUI_subscription;
+
+LinkedList<MGUI_subscription*> subscriptions;
+
 /* Class for handling requests to captive portal */
 class CaptiveRequestHandler : public AsyncWebHandler {
 public:
@@ -104,6 +198,144 @@ public:
   }
 };
 
+/* Queue a change to the GUI, the GUI is only changed from the task running mgui_run() */
+static void guiCommand(MGUI_gui_command_type type, const char * text) {
+  if(gui_queue == NULL) return;
+
+  MGUI_gui_command command = {};
+  command.type = type;
+  strlcpy(command.text, text != NULL ? text : "", sizeof(command.text));
+  if(xQueueSend(gui_queue, &command, 0) != pdTRUE) {
+    Serial.println("[MicroGUI Remote]: GUI queue full, update dropped");
+  }
+}
+
+/* Queue a WebSocket message for mgui_run() to handle, for messages that change the GUI */
+bool mgui_remote_queue_message(uint32_t client_id, const uint8_t * data, size_t len) {
+  if(gui_queue == NULL) return false;
+
+  MGUI_gui_command command = {};
+  command.type = MGUI_GUI_MESSAGE;
+  command.client_id = client_id;
+  command.data = (uint8_t*)malloc(len + 1);     // mgui_remote_message() writes a terminator after the message
+  command.len = len;
+  if(command.data == NULL) return false;
+  memcpy(command.data, data, len);
+
+  // The network side may wait a little for the GUI, rather than lose a message
+  if(xQueueSend(gui_queue, &command, pdMS_TO_TICKS(100)) != pdTRUE) {
+    free(command.data);
+    Serial.println("[MicroGUI Remote]: GUI queue full, message dropped");
+    return false;
+  }
+  return true;
+}
+
+/* Allocate a snapshot buffer, in PSRAM when available */
+static char * snapshotAlloc(size_t len) {
+  char * data = (char*)heap_caps_malloc(len, MALLOC_CAP_SPIRAM);
+  if(data == NULL) data = (char*)heap_caps_malloc(len, MALLOC_CAP_8BIT);
+  return data;
+}
+
+/* Write all registered widgets as the members of a JSON object, returns the length. Only counts when out is NULL */
+static size_t widgetsJson(char * out) {
+  char buf[256];
+  size_t len = 0;
+  bool first = true;
+  for(uint16_t i = 0; i < mgui_object_count(); i++) {
+    MGUI_object * object = mgui_object_at(i);
+    if(object == NULL) continue;
+    size_t n = mgui_widget_json(object, buf, sizeof(buf));
+    if(n == 0) continue;
+
+    if(!first) {
+      if(out != NULL) memcpy(out + len, ", ", 2);
+      len += 2;
+    }
+    first = false;
+    if(out != NULL) memcpy(out + len, buf, n);
+    len += n;
+  }
+  return len;
+}
+
+/* Make a snapshot on the GUI task, data stays NULL if there was not enough memory */
+static void fillSnapshot(MGUI_snapshot * snapshot) {
+  if(snapshot->kind == MGUI_SNAPSHOT_DOCUMENT) {
+    mgui_update_doc();    // Fetch all the latest values/states
+    snapshot->len = strlen(document);
+    snapshot->data = snapshotAlloc(snapshot->len + 1);
+    if(snapshot->data != NULL) memcpy(snapshot->data, document, snapshot->len + 1);
+  }
+  else if(snapshot->kind == MGUI_SNAPSHOT_WIDGETS) {
+    char head[64];
+    size_t head_len = snprintf(head, sizeof(head), "{\"epoch\": %lu, \"version\": %lu, \"widgets\": {", (unsigned long)mgui_state_epoch(), (unsigned long)mgui_state_version());
+    size_t body_len = widgetsJson(NULL);
+    snapshot->data = snapshotAlloc(head_len + body_len + 3);
+    if(snapshot->data != NULL) {
+      memcpy(snapshot->data, head, head_len);
+      widgetsJson(snapshot->data + head_len);
+      memcpy(snapshot->data + head_len + body_len, "}}", 3);
+      snapshot->len = head_len + body_len + 2;
+    }
+  }
+  else if(snapshot->kind == MGUI_SNAPSHOT_WIDGET) {
+    char buf[260];
+    size_t n = 0;
+    snapshot->found = false;
+    for(uint16_t i = 0; i < mgui_object_count(); i++) {
+      MGUI_object * object = mgui_object_at(i);
+      if(object == NULL || strcmp(object->getParent(), snapshot->name) != 0) continue;
+      snapshot->found = true;
+      buf[0] = '{';
+      n = mgui_widget_json(object, buf + 1, sizeof(buf) - 2);
+      if(n > 0) {
+        buf[n + 1] = '}';
+        buf[n + 2] = '\0';
+        n += 2;
+      }
+      break;
+    }
+    // A missing widget is answered too, with an empty snapshot
+    snapshot->data = snapshotAlloc(n + 1);
+    if(snapshot->data != NULL) {
+      memcpy(snapshot->data, n > 0 ? buf : "", n + 1);
+      snapshot->len = n;
+    }
+  }
+  snapshot->hash = mgui_document_hash();
+  snapshot->epoch = mgui_state_epoch();
+  snapshot->version = mgui_state_version();
+}
+
+/* Have the GUI task make a snapshot and wait for it, returns NULL if the GUI did not make it in time.
+   Must not be called from the GUI task */
+static std::shared_ptr<MGUI_snapshot> requestSnapshot(MGUI_snapshot_kind kind, const char * name = NULL) {
+  if(gui_queue == NULL) return NULL;
+
+  std::shared_ptr<MGUI_snapshot> snapshot = std::make_shared<MGUI_snapshot>();
+  snapshot->kind = kind;
+  if(name != NULL) strlcpy(snapshot->name, name, sizeof(snapshot->name));
+  snapshot->done = xSemaphoreCreateBinary();
+  if(snapshot->done == NULL) return NULL;
+
+  MGUI_gui_command command = {};
+  command.type = MGUI_GUI_SNAPSHOT;
+  command.snapshot = new std::shared_ptr<MGUI_snapshot>(snapshot);
+  if(xQueueSend(gui_queue, &command, pdMS_TO_TICKS(100)) != pdTRUE) {
+    delete command.snapshot;
+    return NULL;
+  }
+
+  // If the GUI is late, its reference keeps the snapshot alive until it is done with it
+  if(xSemaphoreTake(snapshot->done, pdMS_TO_TICKS(MGUI_SNAPSHOT_TIMEOUT)) != pdTRUE || snapshot->data == NULL) {
+    Serial.println("[MicroGUI Remote]: GUI busy, no snapshot");
+    return NULL;
+  }
+  return snapshot;
+}
+
 /* When WiFi connects */
 void wifiOnConnect() {
   Serial.println("[MicroGUI Remote]: STA Connected");
@@ -113,15 +345,18 @@ void wifiOnConnect() {
   Serial.println(WiFi.localIP());
   WiFi.mode(WIFI_MODE_STA);     // Close AP mode
   ap_on = false;
-  mgui_hide_border();
-  mgui_set_text(IPTextField, WiFi.localIP().toString().c_str());
+  reconnect_at = 0;
+  reconnect_delay = 1000;
+  guiCommand(MGUI_GUI_HIDE_BORDER, NULL);
+  guiCommand(MGUI_GUI_SET_IP, WiFi.localIP().toString().c_str());
 }
 
 /* When WiFi disconnects */
 void wifiOnDisconnect() {
   Serial.println("[MicroGUI Remote]: STA Disconnected");
-  mgui_show_border();
-  mgui_set_text(IPTextField, "IP: N/A");
+  wifi_disconnects++;
+  guiCommand(MGUI_GUI_SHOW_BORDER, NULL);
+  guiCommand(MGUI_GUI_SET_IP, "IP: N/A");
   
   if(!ap_on) {
     WiFi.mode(WIFI_MODE_APSTA);   // Start AP mode
@@ -133,7 +368,16 @@ void wifiOnDisconnect() {
     Serial.println(WiFi.softAPIP());
     ap_on = true;
   }
-  
+
+  // The network task backs off between attempts, otherwise try again right away
+  if(net_queue != NULL) {
+    if(reconnect_at == 0) {
+      reconnect_at = millis() + reconnect_delay;
+      reconnect_delay = reconnect_delay * 2 < MGUI_RECONNECT_MAX ? reconnect_delay * 2 : MGUI_RECONNECT_MAX;
+    }
+    return;
+  }
+  wifi_reconnects++;
   WiFi.begin(wifiSSID.c_str(), wifiPassword.c_str());   // Try to connect with stored credentials
 }
 
@@ -147,98 +391,632 @@ void WiFiEvent(WiFiEvent_t event) {
       WiFi.setHostname(AP_SSID);
       break;
     case SYSTEM_EVENT_STA_GOT_IP:
-      wifiOnConnect();
       wifi_connected = true;
+      if(net_queue != NULL) {
+        MGUI_net_event net_event = MGUI_NET_CONNECTED;
+        xQueueSend(net_queue, &net_event, 0);
+      } else {
+        wifiOnConnect();
+      }
       break;
     case SYSTEM_EVENT_STA_DISCONNECTED:
       wifi_connected = false;
-      wifiOnDisconnect();
+      if(net_queue != NULL) {
+        MGUI_net_event net_event = MGUI_NET_DISCONNECTED;
+        xQueueSend(net_queue, &net_event, 0);
+      } else {
+        wifiOnDisconnect();
+      }
       break;
     default:
       break;
   }
 }
 
-/* WebSocket message handler */
-void handleWebSocketMessage(AsyncWebSocketClient * client, void *arg, uint8_t *data, size_t len) {
-  AwsFrameInfo *info = (AwsFrameInfo*)arg;
+/* Find the subscription of a WebSocket client, returns NULL if the client has none */
+static MGUI_subscription * findSubscription(uint32_t client_id) {
+  for(int i = 0; i < subscriptions.size(); i++) {
+    if(subscriptions.get(i)->client_id == client_id) return subscriptions.get(i);
+  }
+  return NULL;
+}
+
+/* Called when a new state epoch starts, subscriptions from before point at the wrong objects so they are dropped */
+void mgui_remote_reset_subscriptions() {
+  while(subscriptions.size() > 0) {
+    MGUI_subscription * sub = subscriptions.remove(0);
+    ws.text(sub->client_id, "SUBSCRIPTIONS RESET");
+    free(sub->bits);
+    delete sub;
+  }
+}
+
+/* Remove the subscription of a WebSocket client, it will receive everything again */
+static void removeSubscription(uint32_t client_id) {
+  for(int i = 0; i < subscriptions.size(); i++) {
+    if(subscriptions.get(i)->client_id == client_id) {
+      MGUI_subscription * sub = subscriptions.remove(i);
+      free(sub->bits);
+      delete sub;
+      return;
+    }
+  }
+}
+
+/* Returns true if a WebSocket client should receive updates of the object in a registry slot */
+static bool isSubscribed(uint32_t client_id, uint16_t index) {
+  MGUI_subscription * sub = findSubscription(client_id);
+  if(sub == NULL) return true;
+  if(index / 32 >= sub->words) return false;
+  return sub->bits[index / 32] & (1UL << (index % 32));
+}
+
+/* Arguments for matching objects against a subscription selector */
+typedef struct {
+  MGUI_subscription * sub;
+  const char * selector;
+  bool subscribe;
+  uint16_t matched;
+} MGUI_selector;
+
+/* Set or clear the subscription bit of an object if it matches the selector, 
+   selectors are an object name, "event:<event id>" or "type:<object type>" */
+static void applySelector(MGUI_object * object, void * arg) {
+  MGUI_selector * sel = (MGUI_selector*)arg;
+  bool match;
+  if(strncmp(sel->selector, "event:", 6) == 0) {
+    match = mgui_compare(object->getEvent(), sel->selector + 6);
+  } else if(strncmp(sel->selector, "type:", 5) == 0) {
+    match = mgui_compare(object->getType(), sel->selector + 5);
+  } else {
+    match = mgui_compare(object->getParent(), sel->selector);
+  }
+  if(!match || object->getIndex() / 32 >= sel->sub->words) return;
+
+  if(sel->subscribe) {
+    sel->sub->bits[object->getIndex() / 32] |= (1UL << (object->getIndex() % 32));
+  } else {
+    sel->sub->bits[object->getIndex() / 32] &= ~(1UL << (object->getIndex() % 32));
+  }
+  sel->matched++;
+}
+
+/* Handle "subscribe <selector>" and "unsubscribe <selector>", "*" restores receiving everything */
+static void handleSubscription(uint32_t client_id, const char * selector, bool subscribe) {
+  char buf[40];
+
+  if(strcmp(selector, "*") == 0) {
+    removeSubscription(client_id);
+    ws.text(client_id, "SUBSCRIBED *");
+    return;
+  }
+
+  MGUI_subscription * sub = findSubscription(client_id);
+  if(sub == NULL) {
+    if(!subscribe) {
+      ws.text(client_id, "SUBSCRIBED *");    // Nothing to unsubscribe from when receiving everything
+      return;
+    }
+    sub = new MGUI_subscription;
+    sub->client_id = client_id;
+    sub->words = mgui_object_count() / 32 + 1;
+    sub->bits = (uint32_t*)calloc(sub->words, sizeof(uint32_t));
+    if(sub->bits == NULL) {
+      delete sub;
+      Serial.println("[MicroGUI Remote]: Out of memory, could not subscribe");
+      return;
+    }
+    subscriptions.add(sub);
+  }
+
+  MGUI_selector sel = {sub, selector, subscribe, 0};
+  mgui_for_each_object(applySelector, &sel);
+
+  snprintf(buf, sizeof(buf), "SUBSCRIBED %u", sel.matched);
+  ws.text(client_id, buf);
+}
+
+/* Send the state of a registry slot to the WebSocket client given as argument */
+static void sendSlotState(uint16_t index, void * arg) {
+  size_t len = mgui_slot_message_size(index);
+  if(len == 0 || !isSubscribed(*(uint32_t*)arg, index)) return;
+
+  // Long texts do not fit on the stack
+  char stack_buf[256];
+  char * buf = len <= sizeof(stack_buf) ? stack_buf : (char*)malloc(len);
+  if(buf == NULL) return;
+  if(mgui_slot_message(index, buf, len)) ws.text(*(uint32_t*)arg, buf);
+  if(buf != stack_buf) free(buf);
+}
+
+/* Send the current state version so that the client can ask for a delta when reconnecting */
+static void sendStateVersion(uint32_t client_id) {
+  char buf[40];
+  snprintf(buf, sizeof(buf), "VERSION %lu %lu", (unsigned long)mgui_state_epoch(), (unsigned long)mgui_state_version());
+  ws.text(client_id, buf);
+}
+
+/* Send the content hash of the document, the client can present it in its next documentRequest */
+static void sendDocumentHash(uint32_t client_id) {
+  char buf[20];
+  snprintf(buf, sizeof(buf), "HASH %08lx", (unsigned long)mgui_document_hash());
+  ws.text(client_id, buf);
+}
+
+/* Display mirroring. Flushed areas are copied into a frame kept next to the one the mirroring clients have, and sent
+   from the network side as binary messages of changed pixels. Each message is
+     uint8 'M', uint8 flags (1 for a key frame), uint16 x, y, w, h    Little endian, followed by for every row
+     operations of a byte with the type in the top two bits and count - 1 in the rest
+       MGUI_MIRROR_SKIP      count pixels are unchanged
+       MGUI_MIRROR_REPEAT    one RGB565 pixel repeated count times
+       MGUI_MIRROR_LITERAL   count RGB565 pixels
+   A client starts with a black frame of the size given by "MIRROR <w> <h>" */
+#define MGUI_MIRROR_SKIP 0x00
+#define MGUI_MIRROR_REPEAT 0x40
+#define MGUI_MIRROR_LITERAL 0x80
+#define MGUI_MIRROR_HEADER_SIZE 10
+#define MGUI_MIRROR_RECTS 8
+
+typedef struct {
+  uint32_t client_id;
+  bool fresh;                 // Has not been sent the size and a key frame yet
+} MGUI_mirror_client;
+
+static MGUI_mirror_client mirror_clients[MGUI_MIRROR_CLIENTS];
+static uint8_t mirror_count = 0;
+static uint16_t * mirror_frame = NULL;      // Latest flushed frame
+static uint16_t * mirror_sent = NULL;       // Frame the clients have
+static uint16_t mirror_w = 0, mirror_h = 0;
+static volatile bool mirror_on = false;
+static bool mirror_key = false;
+static lv_area_t mirror_dirty[MGUI_MIRROR_RECTS];
+static uint8_t mirror_dirty_count = 0;
+static uint32_t last_mirror = 0;
+static uint8_t * mirror_buf = NULL;
+static portMUX_TYPE mirror_mux = portMUX_INITIALIZER_UNLOCKED;
+
+/* Add an area to be sent, when out of room all areas become their bounding box. Call with mirror_mux taken */
+static void mirrorMarkDirty(const lv_area_t * area) {
+  if(mirror_dirty_count < MGUI_MIRROR_RECTS) {
+    mirror_dirty[mirror_dirty_count++] = *area;
+    return;
+  }
+  lv_area_t * box = &mirror_dirty[0];
+  for(uint8_t i = 1; i < mirror_dirty_count; i++) {
+    box->x1 = LV_MIN(box->x1, mirror_dirty[i].x1);
+    box->y1 = LV_MIN(box->y1, mirror_dirty[i].y1);
+    box->x2 = LV_MAX(box->x2, mirror_dirty[i].x2);
+    box->y2 = LV_MAX(box->y2, mirror_dirty[i].y2);
+  }
+  box->x1 = LV_MIN(box->x1, area->x1);
+  box->y1 = LV_MIN(box->y1, area->y1);
+  box->x2 = LV_MAX(box->x2, area->x2);
+  box->y2 = LV_MAX(box->y2, area->y2);
+  mirror_dirty_count = 1;
+}
+
+/* Called by display_flush(), only copies the pixels so that mirroring never holds up drawing */
+void mgui_mirror_flush(const lv_area_t * area, const lv_color_t * color_p) {
+  if(!mirror_on) return;
+
+  lv_area_t clip;
+  clip.x1 = LV_MAX(area->x1, 0);
+  clip.y1 = LV_MAX(area->y1, 0);
+  clip.x2 = LV_MIN(area->x2, mirror_w - 1);
+  clip.y2 = LV_MIN(area->y2, mirror_h - 1);
+  if(clip.x1 > clip.x2 || clip.y1 > clip.y2) return;
+
+  uint32_t w = area->x2 - area->x1 + 1;
+  for(int32_t y = clip.y1; y <= clip.y2; y++) {
+    memcpy(mirror_frame + y * mirror_w + clip.x1, &color_p[(y - area->y1) * w + clip.x1 - area->x1], (clip.x2 - clip.x1 + 1) * 2);
+  }
+
+  // The area is marked after it is copied, so a copy made while it is being sent is sent again
+  portENTER_CRITICAL(&mirror_mux);
+  mirrorMarkDirty(&clip);
+  portEXIT_CRITICAL(&mirror_mux);
+}
+
+/* Allocate the frames on the GUI side, in PSRAM when available, and redraw the screen into them */
+static void mirrorStart() {
+  if(mirror_frame == NULL) {
+    lv_disp_t * disp = lv_disp_get_default();
+    mirror_w = disp->driver->hor_res;
+    mirror_h = disp->driver->ver_res;
+    size_t size = (size_t)mirror_w * mirror_h * 2;
+
+    mirror_frame = (uint16_t*)heap_caps_calloc(1, size, MALLOC_CAP_SPIRAM);
+    mirror_sent = (uint16_t*)heap_caps_calloc(1, size, MALLOC_CAP_SPIRAM);
+    if(mirror_frame == NULL) mirror_frame = (uint16_t*)heap_caps_calloc(1, size, MALLOC_CAP_8BIT);
+    if(mirror_sent == NULL) mirror_sent = (uint16_t*)heap_caps_calloc(1, size, MALLOC_CAP_8BIT);
+    if(mirror_buf == NULL) mirror_buf = (uint8_t*)malloc(MGUI_MIRROR_BUFFER);
+
+    if(mirror_frame == NULL || mirror_sent == NULL || mirror_buf == NULL) {
+      Serial.println("[MicroGUI Remote]: Not enough memory to mirror the display");
+      heap_caps_free(mirror_frame);
+      heap_caps_free(mirror_sent);
+      mirror_frame = NULL;
+      mirror_sent = NULL;
+
+      portENTER_CRITICAL(&mirror_mux);
+      uint8_t count = mirror_count;
+      uint32_t ids[MGUI_MIRROR_CLIENTS];
+      for(uint8_t i = 0; i < count; i++) ids[i] = mirror_clients[i].client_id;
+      mirror_count = 0;
+      portEXIT_CRITICAL(&mirror_mux);
+      for(uint8_t i = 0; i < count; i++) ws.text(ids[i], "MIRROR UNAVAILABLE");
+      return;
+    }
+  }
+  mirror_on = true;
+  lv_obj_invalidate(lv_scr_act());
+}
+
+/* "mirror on" and "mirror off" from a WebSocket client */
+static void handleMirror(uint32_t client_id, bool on) {
+  if(client_id == 0) return;    // Replayed
+
+  portENTER_CRITICAL(&mirror_mux);
+  uint8_t i = 0;
+  while(i < mirror_count && mirror_clients[i].client_id != client_id) i++;
+  bool added = false;
+  if(on && i == mirror_count && mirror_count < MGUI_MIRROR_CLIENTS) {
+    mirror_clients[mirror_count].client_id = client_id;
+    mirror_clients[mirror_count].fresh = true;
+    mirror_count++;
+    added = true;
+  }
+  else if(!on && i < mirror_count) {
+    mirror_clients[i] = mirror_clients[--mirror_count];
+    if(mirror_count == 0) mirror_on = false;
+  }
+  bool full = on && !added && i == mirror_count;
+  portEXIT_CRITICAL(&mirror_mux);
+
+  if(full) {
+    ws.text(client_id, "MIRROR BUSY");
+    return;
+  }
+  if(added && !mirror_on) guiCommand(MGUI_GUI_MIRROR, NULL);
+  if(!on) ws.text(client_id, "MIRROR OFF");
+}
+
+/* Whether every mirroring client can take another message, if not the frame is sent later as it is then */
+static bool mirrorCanSend(const uint32_t * ids, uint8_t count) {
+  for(uint8_t i = 0; i < count; i++) {
+    AsyncWebSocketClient * client = ws.client(ids[i]);
+    if(client != NULL && (client->queueIsFull() || !client->canSend())) return false;
+  }
+  return true;
+}
+
+static void mirrorSendBuffer(const uint32_t * ids, uint8_t count, size_t len) {
+  for(uint8_t i = 0; i < count; i++) {
+    AsyncWebSocketClient * client = ws.client(ids[i]);
+    if(client == NULL || client->status() != WS_CONNECTED) continue;
+    countSent(client, len);
+    client->binary(mirror_buf, len);
+  }
+}
+
+static void mirrorHeader(bool key, int32_t x, int32_t y, int32_t w, int32_t h) {
+  uint16_t values[4] = {(uint16_t)x, (uint16_t)y, (uint16_t)w, (uint16_t)h};
+  mirror_buf[0] = 'M';
+  mirror_buf[1] = key ? 1 : 0;
+  memcpy(mirror_buf + 2, values, sizeof(values));
+}
+
+/* Encode one row of an area against the frame the clients have, returns the bytes written */
+static size_t mirrorEncodeRow(uint8_t * out, int32_t x1, int32_t x2, int32_t y, bool key) {
+  uint16_t * frame = mirror_frame + y * mirror_w;
+  uint16_t * sent = mirror_sent + y * mirror_w;
+  size_t n = 0;
+  int32_t x = x1;
+  while(x <= x2) {
+    uint16_t pixel = frame[x];
+    uint8_t count = 1;
+
+    if(!key && pixel == sent[x]) {
+      while(x + count <= x2 && count < 64 && frame[x + count] == sent[x + count]) count++;
+      out[n++] = MGUI_MIRROR_SKIP | (count - 1);
+    }
+    else {
+      while(x + count <= x2 && count < 64 && frame[x + count] == pixel) count++;
+      if(count >= 2) {
+        out[n++] = MGUI_MIRROR_REPEAT | (count - 1);
+        memcpy(out + n, &pixel, 2);
+        n += 2;
+        for(uint8_t i = 0; i < count; i++) sent[x + i] = pixel;
+      }
+      else {
+        // Literal pixels until an unchanged pixel or a repeat starts
+        size_t op = n++;
+        count = 0;
+        while(x + count <= x2 && count < 64) {
+          uint16_t p = frame[x + count];
+          if(count > 0 && ((!key && p == sent[x + count]) || (x + count < x2 && frame[x + count + 1] == p))) break;
+          memcpy(out + n, &p, 2);
+          n += 2;
+          sent[x + count] = p;
+          count++;
+        }
+        out[op] = MGUI_MIRROR_LITERAL | (count - 1);
+      }
+    }
+    x += count;
+  }
+  return n;
+}
+
+/* Send the changed areas to the mirroring clients, called at most MGUI_MIRROR_FPS times a second */
+static void mgui_mirror_send() {
+  if(!mirror_on) return;
+
+  uint32_t ids[MGUI_MIRROR_CLIENTS];
+  uint32_t fresh[MGUI_MIRROR_CLIENTS];
+  uint8_t fresh_count = 0;
+  lv_area_t dirty[MGUI_MIRROR_RECTS];
+
+  portENTER_CRITICAL(&mirror_mux);
+  uint8_t clients = mirror_count;
+  for(uint8_t i = 0; i < clients; i++) {
+    ids[i] = mirror_clients[i].client_id;
+    if(mirror_clients[i].fresh) fresh[fresh_count++] = ids[i];
+    mirror_clients[i].fresh = false;
+  }
+
+  // New clients get the size and then the whole frame, the others get it again as well
+  if(fresh_count > 0) {
+    lv_area_t all = {0, 0, (lv_coord_t)(mirror_w - 1), (lv_coord_t)(mirror_h - 1)};
+    mirror_dirty_count = 0;
+    mirrorMarkDirty(&all);
+    mirror_key = true;
+  }
+
+  uint8_t count = mirror_dirty_count;
+  memcpy(dirty, mirror_dirty, count * sizeof(lv_area_t));
+  mirror_dirty_count = 0;
+  bool key = mirror_key;
+  mirror_key = false;
+  portEXIT_CRITICAL(&mirror_mux);
+
+  for(uint8_t i = 0; i < fresh_count; i++) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "MIRROR %u %u", (unsigned)mirror_w, (unsigned)mirror_h);
+    ws.text(fresh[i], buf);
+  }
+
+  for(uint8_t r = 0; r < count; r++) {
+    lv_area_t * area = &dirty[r];
+    int32_t w = area->x2 - area->x1 + 1;
+    int32_t row_max = 1 + w * 2 + w / 64 + 1;    // Longest encoding of a row, all literals
+    int32_t y = area->y1;
+
+    while(y <= area->y2) {
+      // Under backpressure the rest waits for the next round, which sends the frame as it is by then
+      if(!mirrorCanSend(ids, clients) || MGUI_MIRROR_HEADER_SIZE + row_max > MGUI_MIRROR_BUFFER) {
+        portENTER_CRITICAL(&mirror_mux);
+        for(uint8_t i = r; i < count; i++) {
+          lv_area_t rest = dirty[i];
+          if(i == r) rest.y1 = y;
+          mirrorMarkDirty(&rest);
+        }
+        mirror_key = mirror_key || key;
+        portEXIT_CRITICAL(&mirror_mux);
+        return;
+      }
+
+      size_t len = MGUI_MIRROR_HEADER_SIZE;
+      int32_t y1 = y;
+      while(y <= area->y2 && len + row_max <= MGUI_MIRROR_BUFFER) {
+        len += mirrorEncodeRow(mirror_buf + len, area->x1, area->x2, y, key);
+        y++;
+      }
+      mirrorHeader(key, area->x1, y1, w, y - y1);
+      mirrorSendBuffer(ids, clients, len);
+    }
+  }
+}
+
+/* Stop mirroring to a client that went away */
+static void removeMirror(uint32_t client_id) {
+  portENTER_CRITICAL(&mirror_mux);
+  for(uint8_t i = 0; i < mirror_count; i++) {
+    if(mirror_clients[i].client_id == client_id) {
+      mirror_clients[i] = mirror_clients[--mirror_count];
+      if(mirror_count == 0) mirror_on = false;
+      break;
+    }
+  }
+  portEXIT_CRITICAL(&mirror_mux);
+}
+
+/* Handle a whole text message from a WebSocket client, data needs room for a terminator after len bytes.
+   Runs on the GUI task, from mgui_run(). Requests of the whole document are answered by sendDocument() instead.
+   Replayed messages have client_id 0, which no client has, so the answers to them go nowhere */
+void mgui_remote_message(uint32_t client_id, uint8_t * data, size_t len) {
+  mgui_remote_activity();
 
   static bool new_doc = false;
   // char *new_document;
   // int new_doc_index = 0;
   static String new_document;
 
-  if(info->final && info->index == 0 && info->len == len && info->opcode == WS_TEXT) {
-    data[len] = 0;
-
-    String message = (char*)data;
-
-    /* If document is requested, update the document and send it in chunks */
-    if(strcmp((char*)data, "documentRequest") == 0) {
-      Serial.print(F("[MicroGUI Remote]: Document requested by WebSocket client "));
-      Serial.println(client->id());
-      // Fetch all the latest values/states
-      mgui_update_doc();
-
-      // Send the document to the client that requested it
-      uint16_t chunk_size = 2000;
-      char temp[chunk_size + 1];
-      for(int i = 0; i < strlen(document); i += chunk_size) {
-        strncpy(temp, document + i, chunk_size);
-        temp[chunk_size] = '\0';
-        ws.text(client->id(), temp);
-        delay(50);
-      }
-      ws.text(client->id(), "DOCUMENT SENT");
+  data[len] = 0;
+
+  String message = (char*)data;
 
-      Serial.println("[MicroGUI Remote]: Document sent!");
+  /* If the client already holds a copy of the document, "documentRequest <hash>", only send the state of every object */
+  if(strncmp((char*)data, "documentRequest ", 16) == 0 && strtoul((char*)data + 16, NULL, 16) == mgui_document_hash()) {
+    ws.text(client_id, "DOCUMENT UNCHANGED");
+    mgui_for_each_slot(sendSlotState, &client_id);
+    sendStateVersion(client_id);
+
+    Serial.print(F("[MicroGUI Remote]: Cached document still valid for WebSocket client "));
+    Serial.println(client_id);
+  }
+
+  /* Whole documents are sent by sendDocument() from the network side, only replayed requests end up here */
+  else if(strncmp((char*)data, "documentRequest", 15) == 0) {
+    mgui_update_doc();
+  }
+
+  /* If a reconnecting client asks for the changes since the version it last saw, "syncRequest <epoch> <version>" */
+  else if(strncmp((char*)data, "syncRequest ", 12) == 0) {
+    char *end;
+    uint32_t epoch = strtoul((char*)data + 12, &end, 10);
+    uint32_t since = strtoul(end, NULL, 10);
+
+    if(epoch != mgui_state_epoch()) {
+      // A new GUI has been rendered since, the client needs the whole document
+      ws.text(client_id, "DOCUMENT CHANGED");
+      return;
     }
 
-    /* If the display is prompted to receive a new GUI document */
-    else if(strcmp((char*)data, "newDocument") == 0) {
-      Serial.println("[MicroGUI Remote]: Incoming new document!");
-      new_doc = true;
-      ws.text(client->id(), "OK");
+    if(mgui_for_each_change(since, NULL, NULL)) {
+      ws.text(client_id, "SYNC DELTA");
+      mgui_for_each_change(since, sendSlotState, &client_id);
+    } else {
+      // The journal has wrapped, fall back to sending the state of every object
+      ws.text(client_id, "SYNC SNAPSHOT");
+      mgui_for_each_slot(sendSlotState, &client_id);
     }
+    sendStateVersion(client_id);
+
+    Serial.printf("[MicroGUI Remote]: Client %lu synced from version %lu\n", (unsigned long)client_id, (unsigned long)since);
+  }
 
-    else if(strcmp((char*)data, "NEW DOCUMENT SENT") == 0) {
-      Serial.println("[MicroGUI Remote]: Entire new document sent, time to render!");
-      from_persistant = false;
-      mgui_render((char*)new_document.c_str());
-      new_document = "";
-      new_doc = false;
-      ws.text(client->id(), "NEW DOCUMENT RECEIVED");
+  /* If the editor changes part of the GUI, "patchDocument <patch>", see mgui_patch_document() */
+  else if(strncmp((char*)data, "patchDocument ", 14) == 0) {
+    if(mgui_patch_document((char*)data + 14)) {
+      ws.text(client_id, "PATCH APPLIED");
+      sendDocumentHash(client_id);
+      sendStateVersion(client_id);
+
+      // Let other clients know that their copy of the document is outdated
+      char buf[40];
+      snprintf(buf, sizeof(buf), "DOCUMENT PATCHED %08lx", (unsigned long)mgui_document_hash());
+      mgui_send(buf);
+    } else {
+      ws.text(client_id, "PATCH FAILED");
     }
+  }
 
+  /* If a client wants to see what the display shows, "mirror on" or "mirror off" */
+  else if(strcmp((char*)data, "mirror on") == 0 || strcmp((char*)data, "mirror off") == 0) {
+    handleMirror(client_id, data[8] == 'n');
+  }
+
+  /* If a client only wants updates of some objects, "subscribe <selector>" or "unsubscribe <selector>" */
+  else if(strncmp((char*)data, "subscribe ", 10) == 0) {
+    handleSubscription(client_id, (char*)data + 10, true);
+  }
+
+  else if(strncmp((char*)data, "unsubscribe ", 12) == 0) {
+    handleSubscription(client_id, (char*)data + 12, false);
+  }
+
+  /* If the display is prompted to receive a new GUI document */
+  else if(strcmp((char*)data, "newDocument") == 0) {
+    Serial.println("[MicroGUI Remote]: Incoming new document!");
+    new_doc = true;
+    ws.text(client_id, "OK");
+  }
+
+  else if(strcmp((char*)data, "NEW DOCUMENT SENT") == 0) {
+    Serial.println("[MicroGUI Remote]: Entire new document sent, time to render!");
+    from_persistant = false;
+    mgui_render((char*)new_document.c_str());
+    new_document = "";
+    new_doc = false;
+    ws.text(client_id, "NEW DOCUMENT RECEIVED");
+  }
+
+  else {
+    if(new_doc) {
+      new_document += (char*)data;
+      ws.text(client_id, "OK");
+    }
     else {
-      if(new_doc) {
-        new_document += (char*)data;
-        ws.text(client->id(), "OK");
+      DynamicJsonDocument doc(200);    // Length of JSON plus some slack
+
+      DeserializationError error = deserializeJson(doc, message);
+      if (error) {
+        Serial.print(F("deserializeJson() failed: "));
+        Serial.println(error.f_str());
+        return;
       }
-      else {
-        DynamicJsonDocument doc(200);    // Length of JSON plus some slack
 
-        DeserializationError error = deserializeJson(doc, message);
-        if (error) {
-          Serial.print(F("deserializeJson() failed: "));
-          Serial.println(error.f_str());
-          return;
-        }
+      JsonObject root = doc.as<JsonObject>();
 
-        JsonObject root = doc.as<JsonObject>();
+      mgui_set_value((const char*)root["Parent"], (int)root["Value"], true);
+      mgui_bind_write((const char*)root["Parent"], (int)root["Value"]);
 
-        mgui_set_value((const char*)root["Parent"], (int)root["Value"], true);
+      memcpy(event, (const char*)root["Event"], strlen((const char*)root["Event"]) + 1);
+      memcpy(parent, (const char*)root["Parent"], strlen((const char*)root["Parent"]) + 1);
 
-        memcpy(event, (const char*)root["Event"], strlen((const char*)root["Event"]) + 1);
-        memcpy(parent, (const char*)root["Parent"], strlen((const char*)root["Parent"]) + 1);
+      delete latest;
+      latest = new MGUI_event(event, parent, (int)root["Value"]);
 
-        delete latest;
-        latest = new MGUI_event(event, parent, (int)root["Value"]);
+      new_event = true;
+      mgui_queue_event(latest);
 
-        new_event = true;
+      doc.clear();
+    }
+  }
+}
 
-        doc.clear();
-      }
+/* Send the whole document in chunks to a client that requested it, from the network side with a copy made by the GUI task */
+static void sendDocument(uint32_t client_id) {
+  Serial.print(F("[MicroGUI Remote]: Document requested by WebSocket client "));
+  Serial.println(client_id);
+
+  std::shared_ptr<MGUI_snapshot> snapshot = requestSnapshot(MGUI_SNAPSHOT_DOCUMENT);
+  if(!snapshot) {
+    ws.text(client_id, "DOCUMENT FAILED");
+    return;
+  }
+
+  uint16_t chunk_size = 2000;
+  char temp[chunk_size + 1];
+  for(size_t i = 0; i < snapshot->len; i += chunk_size) {
+    strncpy(temp, snapshot->data + i, chunk_size);
+    temp[chunk_size] = '\0';
+    countSent(ws.client(client_id), strlen(temp));
+    ws.text(client_id, temp);
+    delay(50);
+  }
+  ws.text(client_id, "DOCUMENT SENT");
+
+  // The hash and version the copy was made at, changes since then follow as usual
+  char buf[40];
+  snprintf(buf, sizeof(buf), "HASH %08lx", (unsigned long)snapshot->hash);
+  ws.text(client_id, buf);
+  snprintf(buf, sizeof(buf), "VERSION %lu %lu", (unsigned long)snapshot->epoch, (unsigned long)snapshot->version);
+  ws.text(client_id, buf);
+
+  Serial.println("[MicroGUI Remote]: Document sent!");
+}
+
+/* Handle data from a WebSocket client, only messages in a single frame are supported */
+void handleWebSocketMessage(AsyncWebSocketClient * client, void *arg, uint8_t *data, size_t len) {
+  AwsFrameInfo *info = (AwsFrameInfo*)arg;
+
+  if(info->final && info->index == 0 && info->len == len && info->opcode == WS_TEXT) {
+    mgui_trace_message(data, len);
+
+    // A whole document is sent in paced chunks from here, which would hold up the GUI
+    bool cached = len > 16 && strncmp((char*)data, "documentRequest ", 16) == 0 && strtoul((char*)data + 16, NULL, 16) == mgui_document_hash();
+    if(!cached && len >= 15 && strncmp((char*)data, "documentRequest", 15) == 0) {
+      mgui_remote_activity();
+      sendDocument(client->id());
+      return;
+    }
+
+    // Everything else changes or reads the GUI, objects and subscriptions, which only the GUI task may touch
+    mgui_remote_activity();
+    if(!mgui_remote_queue_message(client->id(), data, len) && len >= 14 && strncmp((char*)data, "patchDocument ", 14) == 0) {
+      ws.text(client->id(), "PATCH FAILED");
     }
   }
 }
@@ -253,40 +1031,459 @@ void onWsEvent(AsyncWebSocket * server, AsyncWebSocketClient * client, AwsEventT
   } 
   else if(type == WS_EVT_DISCONNECT) {
     Serial.println("[MicroGUI Remote]: WebSocket client disconnected");
+    removeMirror(client->id());
+
+    // The subscription is removed by the GUI task, which may be using it
+    MGUI_gui_command command = {};
+    command.type = MGUI_GUI_DISCONNECT;
+    command.client_id = client->id();
+    if(gui_queue != NULL && xQueueSend(gui_queue, &command, pdMS_TO_TICKS(100)) != pdTRUE) {
+      Serial.println("[MicroGUI Remote]: GUI queue full, subscription kept");
+    }
   }
 }
 
-/* Initialize remote MicroGUI */
-void mgui_remote_init() {
+/* Apply every value of a POST /api/widgets batch, all within the same mgui_run() so they show in the same frame */
+static void applyBatch(DynamicJsonDocument * batch) {
+  for(JsonPair kv : batch->as<JsonObject>()) {
+    const char * name = kv.key().c_str();
+    if(kv.value().is<const char*>()) {
+      mgui_set_text(name, kv.value().as<const char*>());
+    }
+    else {
+      int value = kv.value().is<bool>() ? (kv.value().as<bool>() ? 1 : 0) : kv.value().as<int>();
+      mgui_set_value(name, value, true);
+      mgui_bind_write(name, value);
+    }
+  }
+  delete batch;
+}
+
+/* ETag of the widget values, changes with every state change and every render */
+static void widgetsEtag(char * etag, size_t len, uint32_t epoch, uint32_t version) {
+  snprintf(etag, len, "\"%08lx-%lu\"", (unsigned long)epoch, (unsigned long)version);
+}
+
+/* Metrics served at /metrics, in the order they are written */
+typedef enum {
+  MGUI_M_UPTIME,
+  MGUI_M_FRAMES,
+  MGUI_M_FRAME_MS,
+  MGUI_M_FRAME_MAX_MS,
+  MGUI_M_FRAME_MS_TOTAL,
+  MGUI_M_FRAME_PX,
+  MGUI_M_FLUSHES,
+  MGUI_M_FLUSH_PX,
+  MGUI_M_FLUSH_BUS_US,
+  MGUI_M_TOUCH_READS,
+  MGUI_M_TOUCH_BUS_US,
+  MGUI_M_TOUCH_WAIT_MAX_US,
+  MGUI_M_PAGE_SWITCHES,
+  MGUI_M_EVENTS,
+  MGUI_M_EVENTS_DROPPED,
+  MGUI_M_EVENT_QUEUE_DEPTH,
+  MGUI_M_EVENT_QUEUE_SIZE,
+  MGUI_M_WS_CLIENTS,
+  MGUI_M_WS_QUEUE_DEPTH,
+  MGUI_M_WS_MESSAGES,
+  MGUI_M_WS_BYTES,
+  MGUI_M_WS_DROPPED,
+  MGUI_M_HEAP_FREE,
+  MGUI_M_HEAP_MIN_FREE,
+  MGUI_M_HEAP_BIGGEST_FREE,
+  MGUI_M_PSRAM_TOTAL,
+  MGUI_M_PSRAM_FREE,
+  MGUI_M_WIFI_CONNECTED,
+  MGUI_M_WIFI_RSSI,
+  MGUI_M_WIFI_DISCONNECTS,
+  MGUI_M_WIFI_RECONNECTS,
+  MGUI_M_COUNT
+} MGUI_metric_id;
+
+typedef struct {
+  const char * name;
+  const char * type;
+  const char * help;
+} MGUI_metric;
+
+static const MGUI_metric metrics[MGUI_M_COUNT] = {
+  {"mgui_uptime_seconds", "counter", "Seconds since boot"},
+  {"mgui_frames_total", "counter", "Display refreshes"},
+  {"mgui_frame_time_ms", "gauge", "Time taken by the latest refresh"},
+  {"mgui_frame_time_max_ms", "gauge", "Longest refresh"},
+  {"mgui_frame_time_ms_total", "counter", "Time taken by all refreshes"},
+  {"mgui_frame_pixels_total", "counter", "Pixels redrawn"},
+  {"mgui_flushes_total", "counter", "Areas flushed to the display"},
+  {"mgui_flush_pixels_total", "counter", "Pixels flushed to the display"},
+  {"mgui_flush_bus_us_total", "counter", "Microseconds the display has held the bus"},
+  {"mgui_touch_reads_total", "counter", "Touch controller reads"},
+  {"mgui_touch_bus_us_total", "counter", "Microseconds the touch controller has held the bus"},
+  {"mgui_touch_wait_max_us", "gauge", "Longest wait of a touch read for the bus"},
+  {"mgui_page_switches_total", "counter", "Page switches"},
+  {"mgui_events_total", "counter", "Events queued for handlers"},
+  {"mgui_events_dropped_total", "counter", "Events dropped by a full queue or busy worker"},
+  {"mgui_event_queue_depth", "gauge", "Events waiting for mgui_run()"},
+  {"mgui_event_queue_size", "gauge", "Capacity of the event queue"},
+  {"mgui_ws_clients", "gauge", "Connected WebSocket clients"},
+  {"mgui_ws_queue_depth", "gauge", "Messages waiting in all WebSocket client queues"},
+  {"mgui_ws_messages_total", "counter", "WebSocket messages sent"},
+  {"mgui_ws_bytes_total", "counter", "WebSocket bytes sent"},
+  {"mgui_ws_dropped_total", "counter", "WebSocket messages dropped by a full client queue"},
+  {"mgui_heap_free_bytes", "gauge", "Free internal RAM"},
+  {"mgui_heap_min_free_bytes", "gauge", "Least free internal RAM since boot"},
+  {"mgui_heap_biggest_free_bytes", "gauge", "Biggest free block of internal RAM"},
+  {"mgui_psram_total_bytes", "gauge", "PSRAM size, 0 without PSRAM"},
+  {"mgui_psram_free_bytes", "gauge", "Free PSRAM"},
+  {"mgui_wifi_connected", "gauge", "1 if connected to WiFi"},
+  {"mgui_wifi_rssi_dbm", "gauge", "WiFi signal strength"},
+  {"mgui_wifi_disconnects_total", "counter", "WiFi connections lost"},
+  {"mgui_wifi_reconnects_total", "counter", "Attempts to connect to WiFi again"}
+};
+
+/* Values of all metrics at the time of the request, and how far the response has got */
+typedef struct {
+  int64_t values[MGUI_M_COUNT];
+  uint8_t index;
+  char pending[160];
+  size_t len;
+  size_t pos;
+} MGUI_metrics_stream;
+
+/* Take the values of all metrics */
+static void readMetrics(int64_t * values) {
+  // Runs on the web server task, only plain counters are read
+  const MGUI_stats * stats = mgui_stats_counters();
+
+  uint32_t ws_clients = 0;
+  uint32_t ws_queued = 0;
+  for(AsyncWebSocketClient * client : ws.getClients()) {
+    if(client->status() != WS_CONNECTED) continue;
+    ws_clients++;
+    ws_queued += client->queueLen();
+  }
+
+  values[MGUI_M_UPTIME] = millis() / 1000;
+  values[MGUI_M_FRAMES] = stats->frames;
+  values[MGUI_M_FRAME_MS] = stats->last_frame_ms;
+  values[MGUI_M_FRAME_MAX_MS] = stats->max_frame_ms;
+  values[MGUI_M_FRAME_MS_TOTAL] = stats->frame_ms;
+  values[MGUI_M_FRAME_PX] = stats->frame_px;
+  values[MGUI_M_FLUSHES] = stats->flushes;
+  values[MGUI_M_FLUSH_PX] = stats->flush_px;
+  values[MGUI_M_FLUSH_BUS_US] = stats->flush_bus_us;
+  values[MGUI_M_TOUCH_READS] = stats->touch_reads;
+  values[MGUI_M_TOUCH_BUS_US] = stats->touch_bus_us;
+  values[MGUI_M_TOUCH_WAIT_MAX_US] = stats->touch_wait_max_us;
+  values[MGUI_M_PAGE_SWITCHES] = stats->page_switches;
+  values[MGUI_M_EVENTS] = stats->events;
+  values[MGUI_M_EVENTS_DROPPED] = stats->events_dropped;
+  values[MGUI_M_EVENT_QUEUE_DEPTH] = mgui_event_queue_depth();
+  values[MGUI_M_EVENT_QUEUE_SIZE] = MGUI_EVENT_QUEUE;
+  values[MGUI_M_WS_CLIENTS] = ws_clients;
+  values[MGUI_M_WS_QUEUE_DEPTH] = ws_queued;
+  values[MGUI_M_WS_MESSAGES] = ws_messages;
+  values[MGUI_M_WS_BYTES] = ws_bytes;
+  values[MGUI_M_WS_DROPPED] = ws_dropped;
+  values[MGUI_M_HEAP_FREE] = ESP.getFreeHeap();
+  values[MGUI_M_HEAP_MIN_FREE] = ESP.getMinFreeHeap();
+  values[MGUI_M_HEAP_BIGGEST_FREE] = ESP.getMaxAllocHeap();
+  values[MGUI_M_PSRAM_TOTAL] = ESP.getPsramSize();
+  values[MGUI_M_PSRAM_FREE] = ESP.getFreePsram();
+  values[MGUI_M_WIFI_CONNECTED] = wifi_connected ? 1 : 0;
+  values[MGUI_M_WIFI_RSSI] = wifi_connected ? WiFi.RSSI() : 0;
+  values[MGUI_M_WIFI_DISCONNECTS] = wifi_disconnects;
+  values[MGUI_M_WIFI_RECONNECTS] = wifi_reconnects;
+}
+
+/* Fill a chunk of the /metrics response, one metric at a time */
+static size_t fillMetrics(MGUI_metrics_stream * stream, uint8_t * buffer, size_t max_len) {
+  size_t out = 0;
+  while(out < max_len) {
+    if(stream->pos < stream->len) {
+      size_t n = stream->len - stream->pos < max_len - out ? stream->len - stream->pos : max_len - out;
+      memcpy(buffer + out, stream->pending + stream->pos, n);
+      stream->pos += n;
+      out += n;
+      continue;
+    }
+    if(stream->index >= MGUI_M_COUNT) break;
+
+    const MGUI_metric * metric = &metrics[stream->index];
+    int n = snprintf(stream->pending, sizeof(stream->pending), "# HELP %s %s\n# TYPE %s %s\n%s %lld\n",
+                     metric->name, metric->help, metric->name, metric->type, metric->name, (long long)stream->values[stream->index]);
+    stream->len = n > 0 && (size_t)n < sizeof(stream->pending) ? n : 0;
+    stream->pos = 0;
+    stream->index++;
+  }
+  return out;
+}
+
+/* REST API for reading and writing widget values in bulk */
+static void mgui_rest_init() {
+  // GET /api/widgets for all values, GET /api/widgets/<name> for a single one
+  server.on("/api/widgets", HTTP_GET, [](AsyncWebServerRequest *request) {
+    char etag[24];
+    widgetsEtag(etag, sizeof(etag), mgui_state_epoch(), mgui_state_version());
+
+    if(request->hasHeader("If-None-Match") && request->getHeader("If-None-Match")->value().equals(etag)) {
+      request->send(304);
+      return;
+    }
+
+    // The registry and the objects may only be read by the GUI task, the response sends a copy it made
+    bool single = request->url().startsWith("/api/widgets/");
+    String name = single ? request->url().substring(strlen("/api/widgets/")) : String();
+    std::shared_ptr<MGUI_snapshot> snapshot = requestSnapshot(single ? MGUI_SNAPSHOT_WIDGET : MGUI_SNAPSHOT_WIDGETS, name.c_str());
+    if(!snapshot) {
+      request->send(503, "application/json", "{\"error\": \"GUI busy\"}");
+      return;
+    }
+    if(!snapshot->found || snapshot->len == 0) {
+      request->send(404, "application/json", "{\"error\": \"No such widget\"}");
+      return;
+    }
+    widgetsEtag(etag, sizeof(etag), snapshot->epoch, snapshot->version);
+
+    AsyncWebServerResponse *response = request->beginResponse("application/json", snapshot->len, [snapshot](uint8_t *buffer, size_t max_len, size_t index) -> size_t {
+      if(index >= snapshot->len) return 0;
+      size_t n = snapshot->len - index < max_len ? snapshot->len - index : max_len;
+      memcpy(buffer, snapshot->data + index, n);
+      return n;
+    });
+    response->addHeader("ETag", etag);
+    request->send(response);
+  });
+
+  // POST /api/widgets with {"name": value, ...}, the values are applied together by mgui_run()
+  server.on("/api/widgets", HTTP_POST, [](AsyncWebServerRequest *request) {
+    char * body = (char*)request->_tempObject;
+    request->_tempObject = NULL;
+
+    if(body == NULL) {
+      if(request->contentLength() > MGUI_REST_MAX_BODY) request->send(413, "application/json", "{\"error\": \"Batch too large\"}");
+      else request->send(400, "application/json", "{\"error\": \"Empty batch\"}");
+      return;
+    }
+
+    DynamicJsonDocument * batch = new DynamicJsonDocument(mgui_json_capacity(strlen(body)));
+    DeserializationError error = deserializeJson(*batch, body);
+    free(body);
+    if(error || !batch->is<JsonObject>()) {
+      delete batch;
+      request->send(400, "application/json", "{\"error\": \"Expected an object of widget names and values\"}");
+      return;
+    }
+
+    size_t count = 0;
+    for(JsonPair kv : batch->as<JsonObject>()) {
+      if(!kv.value().is<int>() && !kv.value().is<bool>() && !kv.value().is<const char*>()) {
+        delete batch;
+        request->send(400, "application/json", "{\"error\": \"Values must be numbers, booleans or strings\"}");
+        return;
+      }
+      if(kv.value().is<const char*>() && strlen(kv.value().as<const char*>()) > MGUI_REST_MAX_TEXT) {
+        delete batch;
+        request->send(400, "application/json", "{\"error\": \"Text too long\"}");
+        return;
+      }
+      count++;
+    }
+
+    MGUI_gui_command command = {};
+    command.type = MGUI_GUI_APPLY_BATCH;
+    command.batch = batch;
+    if(gui_queue == NULL || xQueueSend(gui_queue, &command, 0) != pdTRUE) {
+      delete batch;
+      request->send(503, "application/json", "{\"error\": \"GUI busy\"}");
+      return;
+    }
+    mgui_remote_activity();
+
+    char buf[32];
+    snprintf(buf, sizeof(buf), "{\"queued\": %u}", (unsigned)count);
+    request->send(202, "application/json", buf);
+  }, NULL, [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+    // Collect the body, which may arrive in several parts
+    if(total > MGUI_REST_MAX_BODY) return;
+    if(index == 0) request->_tempObject = malloc(total + 1);
+    char * body = (char*)request->_tempObject;
+    if(body == NULL || index + len > total) return;
+    memcpy(body + index, data, len);
+    if(index + len == total) body[total] = '\0';
+  });
+}
+
+/* Start the web server and WiFi */
+static void mgui_remote_begin() {
   snprintf(AP_SSID, 23, "MicroGUI-%04X", (uint16_t)ESP.getEfuseMac());    // Create an AP SSID from MAC address
 
   WiFi.onEvent(WiFiEvent);
   WiFi.mode(WIFI_MODE_STA);
 
-  // Captive portal
-  dnsServer.start(53, "*", WiFi.softAPIP());
-  server.addHandler(new CaptiveRequestHandler()).setFilter(ON_AP_FILTER);
-
   // WebSocket
   ws.onEvent(onWsEvent);
   server.addHandler(&ws);
 
+  // GUI document over HTTP, with the content hash and state version as ETag
+  server.on("/document", HTTP_GET, [](AsyncWebServerRequest *request) {
+    char etag[40];
+    snprintf(etag, sizeof(etag), "\"%08lx-%08lx-%lu\"", (unsigned long)mgui_document_hash(), (unsigned long)mgui_state_epoch(), (unsigned long)mgui_state_version());
+
+    if(request->hasHeader("If-None-Match") && request->getHeader("If-None-Match")->value().equals(etag)) {
+      request->send(304);
+      return;
+    }
+
+    // The document may only be read and changed by the GUI task, the response sends a copy it made
+    std::shared_ptr<MGUI_snapshot> snapshot = requestSnapshot(MGUI_SNAPSHOT_DOCUMENT);
+    if(!snapshot) {
+      request->send(503, "text/plain", "GUI busy");
+      return;
+    }
+    snprintf(etag, sizeof(etag), "\"%08lx-%08lx-%lu\"", (unsigned long)snapshot->hash, (unsigned long)snapshot->epoch, (unsigned long)snapshot->version);
+
+    AsyncWebServerResponse *response = request->beginResponse("application/json", snapshot->len, [snapshot](uint8_t *buffer, size_t max_len, size_t index) -> size_t {
+      if(index >= snapshot->len) return 0;
+      size_t n = snapshot->len - index < max_len ? snapshot->len - index : max_len;
+      memcpy(buffer, snapshot->data + index, n);
+      return n;
+    });
+    response->addHeader("ETag", etag);
+    request->send(response);
+  });
+
+  mgui_rest_init();
+
+  // The latest recorded trace, see mgui_record_start()
+  server.on("/trace", HTTP_GET, [](AsyncWebServerRequest *request) {
+    size_t len;
+    const uint8_t * data = mgui_trace_data(&len);
+    if(data == NULL || len == 0) {
+      request->send(404, "text/plain", "No trace recorded");
+      return;
+    }
+    request->send(request->beginResponse_P(200, "application/octet-stream", data, len));
+  });
+
+  // Replay an uploaded trace, "/trace?speed=2" to replay it twice as fast
+  server.on("/trace", HTTP_POST, [](AsyncWebServerRequest *request) {
+    uint8_t * body = (uint8_t*)request->_tempObject;
+    request->_tempObject = NULL;
+    if(body == NULL) {
+      request->send(request->contentLength() > MGUI_TRACE_SIZE ? 413 : 400, "text/plain", "Expected an MGT1 trace");
+      return;
+    }
+
+    float speed = request->hasParam("speed") ? request->getParam("speed")->value().toFloat() : 1;
+    bool started = mgui_replay(body, request->contentLength(), speed);
+    heap_caps_free(body);
+    request->send(started ? 202 : 409, "text/plain", started ? "Replay started" : "Could not start the replay");
+  }, NULL, [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+    if(total > MGUI_TRACE_SIZE) return;
+    if(index == 0) {
+      request->_tempObject = heap_caps_malloc(total, MALLOC_CAP_SPIRAM);
+      if(request->_tempObject == NULL) request->_tempObject = heap_caps_malloc(total, MALLOC_CAP_8BIT);
+    }
+    if(request->_tempObject == NULL || index + len > total) return;
+    memcpy((uint8_t*)request->_tempObject + index, data, len);
+  });
+
+  // Runtime counters in the Prometheus text format, the values are read once and written out as the response is sent
+  server.on("/metrics", HTTP_GET, [](AsyncWebServerRequest *request) {
+    std::shared_ptr<MGUI_metrics_stream> stream = std::make_shared<MGUI_metrics_stream>();
+    readMetrics(stream->values);
+    stream->index = 0;
+    stream->len = 0;
+    stream->pos = 0;
+
+    request->send(request->beginChunkedResponse("text/plain; version=0.0.4", [stream](uint8_t *buffer, size_t max_len, size_t index) -> size_t {
+      return fillMetrics(stream.get(), buffer, max_len);
+    }));
+  });
+
+  // Captive portal, added last as it takes every request on the AP that no handler above takes
+  dnsServer.start(53, "*", WiFi.softAPIP());
+  server.addHandler(new CaptiveRequestHandler()).setFilter(ON_AP_FILTER);
+
   server.begin();
 
   Serial.println("[MicroGUI Remote]: Web server initialized!");
   remoteInit = true;
+  mgui_boot_remote_ready();
 
-  // WiFi connection
-  preferences.begin("wifi", false);
-  wifiSSID = preferences.getString("ssid", "none");           // SSID and Password stored in non-volatile storage
-  wifiPassword = preferences.getString("password", "none");
-  preferences.end();
+  // WiFi connection, with its own Preferences as this may run next to the GUI storing its document
+  Preferences wifi_preferences;
+  wifi_preferences.begin("wifi", false);
+  wifiSSID = wifi_preferences.getString("ssid", "none");           // SSID and Password stored in non-volatile storage
+  wifiPassword = wifi_preferences.getString("password", "none");
+  wifi_preferences.end();
   Serial.print("[MicroGUI Remote]: Stored SSID: ");
   Serial.println(wifiSSID);
 
   WiFi.begin(wifiSSID.c_str(), wifiPassword.c_str());
 }
 
+/* DNS for the captive portal and cleanup of closed WebSocket clients */
+static void mgui_remote_housekeeping() {
+  dnsServer.processNextRequest();
+
+  if(millis() - last_cleanup > 1000) {
+    ws.cleanupClients();
+    last_cleanup = millis();
+  }
+
+  if(mirror_on && millis() - last_mirror >= 1000 / MGUI_MIRROR_FPS) {
+    mgui_mirror_send();
+    last_mirror = millis();
+  }
+}
+
+#if MGUI_NET_TASK
+/* Owns the network after starting it, only talks to the GUI through the GUI queue */
+static void mgui_net_task(void * param) {
+  mgui_remote_begin();
+
+  while(true) {
+    // Wait for WiFi events, at most until DNS needs polling again
+    MGUI_net_event net_event;
+    if(xQueueReceive(net_queue, &net_event, pdMS_TO_TICKS(MGUI_NET_PERIOD)) == pdTRUE) {
+      if(net_event == MGUI_NET_CONNECTED) wifiOnConnect();
+      else wifiOnDisconnect();
+    }
+
+    if(reconnect_at != 0 && (int32_t)(millis() - reconnect_at) >= 0) {
+      reconnect_at = 0;
+      wifi_reconnects++;
+      WiFi.begin(wifiSSID.c_str(), wifiPassword.c_str());
+    }
+
+    mgui_remote_housekeeping();
+  }
+}
+#elif MGUI_REMOTE_DEFER
+static void mgui_remote_task(void * param) {
+  mgui_remote_begin();
+  vTaskDelete(NULL);
+}
+#endif
+
+/* Initialize remote MicroGUI, in the background so that the GUI is usable while WiFi starts */
+void mgui_remote_init() {
+  if(gui_queue == NULL) gui_queue = xQueueCreate(16, sizeof(MGUI_gui_command));
+
+  #if MGUI_NET_TASK
+  net_queue = xQueueCreate(4, sizeof(MGUI_net_event));
+  if(net_queue != NULL && xTaskCreatePinnedToCore(mgui_net_task, "mgui_net", 6144, NULL, 1, NULL, 0) == pdPASS) return;
+  if(net_queue != NULL) vQueueDelete(net_queue);
+  net_queue = NULL;
+  Serial.println("[MicroGUI Remote]: Could not start the network task");
+  #elif MGUI_REMOTE_DEFER
+  if(xTaskCreatePinnedToCore(mgui_remote_task, "mgui_remote", 6144, NULL, 1, NULL, 0) == pdPASS) return;
+  Serial.println("[MicroGUI Remote]: Could not start in the background");
+  #endif
+  mgui_remote_begin();
+}
+
 /* Initialize remote MicroGUI and set any textfield to display the IP address of the screen */
 void mgui_remote_init(const char * textfield) {
   memcpy(IPTextField, textfield, strlen(textfield) + 1);
@@ -325,12 +1522,58 @@ bool getRemoteInit() {
 
 /* Broadcast a WebSocket message */
 void mgui_send(const char * msg) {
+  for(AsyncWebSocketClient * client : ws.getClients()) {
+    if(client->status() == WS_CONNECTED) countSent(client, strlen(msg));
+  }
   ws.textAll(msg);
 }
 
-/* This needs to be in the loop for captive portal to work */
+/* Send a WebSocket message about an object, only to the clients subscribed to it */
+void mgui_send(MGUI_object * object, const char * msg) {
+  mgui_send_slot(object->getIndex(), msg);
+}
+
+/* Send a WebSocket message about the object in a registry slot, built or not, only to the clients subscribed to it */
+void mgui_send_slot(uint16_t index, const char * msg) {
+  if(subscriptions.size() == 0) {
+    mgui_send(msg);
+    return;
+  }
+
+  for(AsyncWebSocketClient * client : ws.getClients()) {
+    if(client->status() == WS_CONNECTED && isSubscribed(client->id(), index)) {
+      countSent(client, strlen(msg));
+      client->text(msg);
+    }
+  }
+}
+
+/* Called from mgui_run(), applies changes queued by the network and runs the captive portal unless the network task does */
 void mgui_run_captive() {
-  dnsServer.processNextRequest();
+  MGUI_gui_command command;
+  while(gui_queue != NULL && xQueueReceive(gui_queue, &command, 0) == pdTRUE) {
+    switch(command.type) {
+      case MGUI_GUI_SET_IP: mgui_set_text(IPTextField, command.text); break;
+      case MGUI_GUI_SHOW_BORDER: mgui_show_border(); break;
+      case MGUI_GUI_HIDE_BORDER: mgui_hide_border(); break;
+      case MGUI_GUI_APPLY_BATCH: applyBatch(command.batch); break;
+      case MGUI_GUI_MIRROR: mirrorStart(); break;
+      case MGUI_GUI_MESSAGE:
+        mgui_remote_message(command.client_id, command.data, command.len);
+        free(command.data);
+        break;
+      case MGUI_GUI_DISCONNECT: removeSubscription(command.client_id); break;
+      case MGUI_GUI_SNAPSHOT:
+        fillSnapshot(command.snapshot->get());
+        xSemaphoreGive((*command.snapshot)->done);
+        delete command.snapshot;
+        break;
+    }
+  }
+
+  if(net_queue == NULL) {
+    mgui_remote_housekeeping();
+  }
 }
 
 /* Returns true if MicroGUI is connected to WiFi */
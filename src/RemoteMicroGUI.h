@@ -13,6 +13,8 @@
 
 #include <Preferences.h>
 
+#include "MicroGUI.h"
+
 extern Preferences preferences;
 
 /* MicroGUI Remote functions */
@@ -23,8 +25,14 @@ void mgui_remote_init(const char * ssid, const char * password, const char * tex
 bool getRemoteInit();
 
 void mgui_send(const char * msg);
+void mgui_send(MGUI_object * object, const char * msg);
+void mgui_send_slot(uint16_t index, const char * msg);
 
 void mgui_run_captive();
+void mgui_remote_message(uint32_t client_id, uint8_t * data, size_t len);
+bool mgui_remote_queue_message(uint32_t client_id, const uint8_t * data, size_t len);
+void mgui_remote_reset_subscriptions();
+void mgui_mirror_flush(const lv_area_t * area, const lv_color_t * color_p);
 
 bool mgui_remote_connected();
 
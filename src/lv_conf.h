@@ -348,6 +348,13 @@
  *   FONT USAGE
  *===================*/
 
+/*MicroGUI loads fonts from files when MGUI_FONT_FILES is defined, only the default font is compiled in then*/
+#ifdef MGUI_FONT_FILES
+    #define MGUI_BUILTIN_FONTS 0
+#else
+    #define MGUI_BUILTIN_FONTS 1
+#endif
+
 /*Montserrat fonts with ASCII range and some symbols using bpp = 4
  *https://fonts.google.com/specimen/Montserrat*/
 #define LV_FONT_MONTSERRAT_8  0
@@ -355,18 +362,18 @@
 #define LV_FONT_MONTSERRAT_12 0
 #define LV_FONT_MONTSERRAT_14 1
 #define LV_FONT_MONTSERRAT_16 0
-#define LV_FONT_MONTSERRAT_18 1
+#define LV_FONT_MONTSERRAT_18 MGUI_BUILTIN_FONTS
 #define LV_FONT_MONTSERRAT_20 0
 #define LV_FONT_MONTSERRAT_22 0
-#define LV_FONT_MONTSERRAT_24 1
+#define LV_FONT_MONTSERRAT_24 MGUI_BUILTIN_FONTS
 #define LV_FONT_MONTSERRAT_26 0
 #define LV_FONT_MONTSERRAT_28 0
 #define LV_FONT_MONTSERRAT_30 0
-#define LV_FONT_MONTSERRAT_32 1
+#define LV_FONT_MONTSERRAT_32 MGUI_BUILTIN_FONTS
 #define LV_FONT_MONTSERRAT_34 0
 #define LV_FONT_MONTSERRAT_36 0
 #define LV_FONT_MONTSERRAT_38 0
-#define LV_FONT_MONTSERRAT_40 1
+#define LV_FONT_MONTSERRAT_40 MGUI_BUILTIN_FONTS
 #define LV_FONT_MONTSERRAT_42 0
 #define LV_FONT_MONTSERRAT_44 0
 #define LV_FONT_MONTSERRAT_46 0
@@ -597,10 +604,14 @@
 
 /*File system interfaces for common APIs */
 
-/*API for fopen, fread, etc*/
-#define LV_USE_FS_STDIO 0
+/*API for fopen, fread, etc. Used by MicroGUI for font and image files*/
+#if defined(MGUI_FONT_FILES) || defined(MGUI_IMAGE_FILES)
+    #define LV_USE_FS_STDIO 1
+#else
+    #define LV_USE_FS_STDIO 0
+#endif
 #if LV_USE_FS_STDIO
-    #define LV_FS_STDIO_LETTER '\0'     /*Set an upper cased letter on which the drive will accessible (e.g. 'A')*/
+    #define LV_FS_STDIO_LETTER 'S'     /*Set an upper cased letter on which the drive will accessible (e.g. 'A')*/
     #define LV_FS_STDIO_PATH ""         /*Set the working directory. File/directory paths will be appended to it.*/
     #define LV_FS_STDIO_CACHE_SIZE 0    /*>0 to cache this number of bytes in lv_fs_read()*/
 #endif
@@ -677,7 +688,7 @@
  *----------*/
 
 /*1: Enable API to take snapshot for object*/
-#define LV_USE_SNAPSHOT 0
+#define LV_USE_SNAPSHOT 1
 
 /*1: Enable Monkey test*/
 #define LV_USE_MONKEY 0
@@ -0,0 +1,80 @@
+#!/usr/bin/env python3
+#
+#   Converts an image to the MGI1 format used by MicroGUI Embedded, see src/MicroGUIImage.cpp
+#
+#   Usage: mgui_image.py input.png output.mgi        Image file for a filesystem
+#          mgui_image.py input.png output.h NAME     C array to compile into flash, register with
+#                                                   mgui_image_register("NAME", NAME, sizeof(NAME));
+#
+#   Requires Pillow (pip install pillow)
+#
+
+import struct
+import sys
+
+from PIL import Image
+
+
+def rgb565(pixel):
+    r, g, b = pixel[:3]
+    return ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3)
+
+
+def encode_row(row):
+    out = bytearray()
+    i = 0
+    while i < len(row):
+        # Runs of at least 3 equal pixels are repeated, everything else is stored as literals
+        run = 1
+        while i + run < len(row) and run < 128 and row[i + run] == row[i]:
+            run += 1
+        if run >= 3:
+            out += struct.pack("<BH", run + 127, row[i])
+            i += run
+            continue
+
+        start = i
+        while i < len(row) and i - start < 128:
+            if i + 2 < len(row) and row[i] == row[i + 1] == row[i + 2]:
+                break
+            i += 1
+        out.append(i - start - 1)
+        out += struct.pack("<%dH" % (i - start), *row[start:i])
+    return out
+
+
+def convert(path):
+    image = Image.open(path).convert("RGB")
+    width, height = image.size
+    pixels = [rgb565(p) for p in image.getdata()]
+
+    offsets = []
+    data = bytearray()
+    for y in range(height):
+        offsets.append(len(data))
+        data += encode_row(pixels[y * width:(y + 1) * width])
+
+    return b"MGI1" + struct.pack("<HH", width, height) + struct.pack("<%dI" % height, *offsets) + data
+
+
+def main():
+    if len(sys.argv) not in (3, 4):
+        print("Usage: mgui_image.py input.png output.mgi | output.h NAME")
+        sys.exit(1)
+
+    mgi = convert(sys.argv[1])
+    if len(sys.argv) == 3:
+        with open(sys.argv[2], "wb") as f:
+            f.write(mgi)
+    else:
+        name = sys.argv[3]
+        with open(sys.argv[2], "w") as f:
+            f.write("const uint8_t %s[] = {\n" % name)
+            for i in range(0, len(mgi), 16):
+                f.write("  " + ", ".join("0x%02x" % b for b in mgi[i:i + 16]) + ",\n")
+            f.write("};\n")
+    print("%s: %d bytes" % (sys.argv[2], len(mgi)))
+
+
+if __name__ == "__main__":
+    main()